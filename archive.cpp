@@ -0,0 +1,528 @@
+﻿/*
+Copyright (c) 2016, oasi-adamay
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+* Neither the name of glsCV nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*!
+@file	archive.cpp
+@author	oasi-adamay
+@brief	解のアーカイブ。解をバイナリ形式で書き出し、メモリマップして読み出す。
+
+ファイル形式
+- ヘッダ (archive_header_t)
+- 解のレコード (record_size byte x solution_num) 表示順(行優先)の各セルのピース番号。空きセルは ARCHIVE_CELL_EMPTY、穴は ARCHIVE_CELL_HOLE
+- 索引 ((fingerprint, 解の番号) x solution_num) fingerprint順に整列済み
+
+レコードは固定長なので、N番目の解は record_offset + N * record_size から読める。
+索引は、解(compact形式の文字列)からその番号を二分探索で引くために使う。
+*/
+
+//-----------------------------------------------------------------------------
+// generic include
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <vector>
+#include <string>
+#include <algorithm>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "pentomino.h"
+#include "pentomino_internal.h"
+
+using namespace std;
+
+/*!
+const & define macro
+*/
+#define ARCHIVE_MAGIC		"PENTOARC"		//file magic (8 byte)
+#define ARCHIVE_VERSION		1				//file format version
+#define ARCHIVE_CELL_EMPTY	0xFF			//empty cell in record
+#define ARCHIVE_CELL_HOLE	0xFE			//hole in record
+#define ARCHIVE_NAME_MAX	64				//max number of pieces
+#define ARCHIVE_SIDE_MAX	4096			//max rows (cols) of the board
+
+/*!
+archive header
+*/
+struct archive_header_t {
+	char		magic[8];		//!< ARCHIVE_MAGIC
+	uint32_t	version;		//!< ARCHIVE_VERSION
+	uint32_t	header_size;	//!< sizeof(archive_header_t)
+	uint32_t	rows;			//!< 表示するボードの行数
+	uint32_t	cols;			//!< 表示するボードの列数
+	uint32_t	swap_ij;		//!< 行と列を入れ替えて探索したか?
+	uint32_t	symmetry;		//!< 1:回転・鏡像による解を同一とした(remove_redundant_shape)
+	uint32_t	piece_num;		//!< ピースの数
+	uint32_t	record_size;	//!< 1解あたりのレコードサイズ (rows*cols)
+	uint64_t	solution_num;	//!< 解の数
+	uint64_t	record_offset;	//!< 先頭レコードのファイル位置
+	uint64_t	index_offset;	//!< 索引のファイル位置
+	char		names[ARCHIVE_NAME_MAX];	//!< ピース番号 -> ピース名
+};
+
+/*!
+index entry
+*/
+struct archive_index_t {
+	uint64_t	fingerprint;	//!< 解のfingerprint
+	uint64_t	no;				//!< 解の番号 (0 origin)
+};
+
+
+//-----------------------------------------------------------------------------
+// private functions
+
+/*!
+memory mapped file (read only)
+*/
+class MappedFile {
+private:
+	const unsigned char* ptr;
+	size_t sz;
+#ifdef _WIN32
+	HANDLE file;
+	HANDLE mapping;
+#endif
+public:
+	MappedFile(void) : ptr(NULL), sz(0) {}
+	~MappedFile(void) { Close(); }
+	const unsigned char* data(void) const { return ptr; }
+	size_t size(void) const { return sz; }
+
+	bool Open(const char* path){
+#ifdef _WIN32
+		file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+		if (file == INVALID_HANDLE_VALUE) return false;
+		LARGE_INTEGER li;
+		GetFileSizeEx(file, &li);
+		sz = (size_t)li.QuadPart;
+		mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (mapping == NULL) { CloseHandle(file); return false; }
+		ptr = (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		if (ptr == NULL) { CloseHandle(mapping); CloseHandle(file); return false; }
+#else
+		int fd = open(path, O_RDONLY);
+		if (fd < 0) return false;
+		struct stat st;
+		if (fstat(fd, &st) < 0 || st.st_size == 0) { close(fd); return false; }
+		sz = (size_t)st.st_size;
+		void* p = mmap(NULL, sz, PROT_READ, MAP_SHARED, fd, 0);
+		close(fd);
+		if (p == MAP_FAILED) return false;
+		ptr = (const unsigned char*)p;
+#endif
+		return true;
+	}
+
+	void Close(void){
+		if (ptr == NULL) return;
+#ifdef _WIN32
+		UnmapViewOfFile(ptr);
+		CloseHandle(mapping);
+		CloseHandle(file);
+#else
+		munmap((void*)ptr, sz);
+#endif
+		ptr = NULL;
+	}
+};
+
+/*!
+アーカイブのヘッダの検証
+
+壊れた(途中で切れた)アーカイブを読んで範囲外をアクセスしないよう、
+mmapした領域をアクセスする前に、ヘッダとレコード・索引のオフセットとサイズを確かめる。
+(開くたびにファイル全体を読まないよう、索引の解の番号とレコードは使う時に確かめる)
+
+@return true:正しいアーカイブ
+*/
+static bool validate_archive(const MappedFile& file){
+	if (file.size() < sizeof(archive_header_t)) return false;
+
+	const archive_header_t* header = (const archive_header_t*)file.data();
+	if (memcmp(header->magic, ARCHIVE_MAGIC, sizeof(header->magic)) != 0
+		|| header->version != ARCHIVE_VERSION || header->header_size != sizeof(archive_header_t)
+		|| header->piece_num > ARCHIVE_NAME_MAX) {
+		return false;
+	}
+
+	//ボードの大きさ (64bitで計算する)
+	if (header->rows < 1 || header->rows > ARCHIVE_SIDE_MAX || header->cols < 1 || header->cols > ARCHIVE_SIDE_MAX
+		|| (uint64_t)header->record_size != (uint64_t)header->rows * header->cols) {
+		return false;
+	}
+
+	//レコードと索引の位置 (掛け算が溢れないよう、割り算で比べる)
+	const uint64_t size = file.size();
+	if (header->record_offset < sizeof(archive_header_t) || header->record_offset > size
+		|| header->index_offset < header->record_offset || header->index_offset > size
+		|| header->solution_num > (header->index_offset - header->record_offset) / header->record_size
+		|| header->solution_num > (size - header->index_offset) / sizeof(archive_index_t)) {
+		return false;
+	}
+	return true;
+}
+
+/*!
+レコードの検証 (全てのセルが、ピース番号・空き・穴のいずれか)
+
+@return true:正しいレコード
+*/
+static bool validate_record(const archive_header_t* header, const unsigned char* rec){
+	for (uint32_t i = 0; i < header->record_size; i++) {
+		const unsigned char v = rec[i];
+		if (v >= header->piece_num && v != ARCHIVE_CELL_EMPTY && v != ARCHIVE_CELL_HOLE) return false;
+	}
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// ArchiveWriter
+
+/*!
+アーカイブの作成
+
+@param path アーカイブファイル
+@param pieces ペントミノデータ配列 (ボード上のピース番号に対応)
+@param _rows 探索しているボードの行数
+@param _cols 探索しているボードの列数
+@param _swap_ij 行と列を入れ替えて探索しているか?
+@param _symmetry 回転・鏡像による解を同一としているか?(remove_redundant_shape)
+
+@return true:成功
+*/
+bool ArchiveWriter::Open(const char* path, const vector<Piece>& pieces, const int _rows, const int _cols, const bool _swap_ij, const bool _symmetry)
+{
+	if ((int)pieces.size() > ARCHIVE_NAME_MAX) return false;
+
+	fp = fopen(path, "wb");
+	if (fp == NULL) {
+		fprintf(stderr, "can not open archive: %s\n", path);
+		return false;
+	}
+
+	file_path = path;
+	rows = _rows;
+	cols = _cols;
+	swap_ij = _swap_ij;
+	symmetry = _symmetry;
+	write_error = false;
+
+	names.resize(pieces.size());
+	for (int i = 0; i < (int)pieces.size(); i++) names[i] = pieces[i].name;
+
+	order.clear();
+	if (swap_ij) {
+		for (int x = 0; x < cols; x++) for (int y = 0; y < rows; y++) order.push_back(y * (cols + 1) + x);
+	}
+	else {
+		for (int y = 0; y < rows; y++) for (int x = 0; x < cols; x++) order.push_back(y * (cols + 1) + x);
+	}
+	record.resize(order.size());
+	index.clear();
+
+	//ヘッダの領域を確保しておく (Closeで書き直す)
+	archive_header_t header;
+	memset(&header, 0, sizeof(header));
+	if (fwrite(&header, sizeof(header), 1, fp) != 1) write_error = true;
+	return true;
+}
+
+/*!
+解のレコードを書き出す
+*/
+void ArchiveWriter::Push(const vector<int>& board)
+{
+	if (fp == NULL) return;
+
+	string text(order.size(), ' ');
+	for (size_t i = 0; i < order.size(); i++) {
+		const int n = board[order[i]];
+		record[i] = (n == BOARD_CELL_EMPTY) ? ARCHIVE_CELL_EMPTY : (n == BOARD_CELL_BOARDER) ? ARCHIVE_CELL_HOLE : (unsigned char)n;
+		text[i] = (n == BOARD_CELL_EMPTY) ? ' ' : (n == BOARD_CELL_BOARDER) ? '#' : names[n];
+	}
+	if (fwrite(&record[0], 1, record.size(), fp) != record.size()) write_error = true;
+
+	index.push_back(make_pair(solution_fingerprint(text.data(), text.size()), (unsigned long long)index.size()));
+}
+
+/*!
+索引とヘッダを書き出して閉じる
+
+書き込みに失敗した場合(ディスクフルなど)は、ヘッダを書き直さない。
+(Openで書いた0のヘッダのままなので、正しいアーカイブとして読めない)
+
+@return true:成功 (開いていない場合も含む)
+*/
+bool ArchiveWriter::Close(void)
+{
+	if (fp == NULL) return true;
+
+	archive_header_t header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, ARCHIVE_MAGIC, sizeof(header.magic));
+	header.version = ARCHIVE_VERSION;
+	header.header_size = sizeof(header);
+	header.rows = swap_ij ? cols : rows;
+	header.cols = swap_ij ? rows : cols;
+	header.swap_ij = swap_ij;
+	header.symmetry = symmetry ? 1 : 0;
+	header.piece_num = (uint32_t)names.size();
+	header.record_size = (uint32_t)record.size();
+	header.solution_num = index.size();
+	header.record_offset = sizeof(header);
+	header.index_offset = header.record_offset + header.solution_num * header.record_size;
+	memcpy(header.names, names.data(), names.size());
+
+	sort(index.begin(), index.end());
+	for (auto& e : index) {
+		archive_index_t entry = { e.first, e.second };
+		if (fwrite(&entry, sizeof(entry), 1, fp) != 1) write_error = true;
+	}
+
+	if (fflush(fp) != 0) write_error = true;
+	if (!write_error && (fseek(fp, 0, SEEK_SET) != 0 || fwrite(&header, sizeof(header), 1, fp) != 1)) write_error = true;
+	if (fclose(fp) != 0) write_error = true;
+	fp = NULL;
+
+	if (write_error) {
+		fprintf(stderr, "can not write archive: %s\n", file_path.c_str());
+		return false;
+	}
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// public functions
+
+/*!
+解のfingerprint (表示順のピース名の FNV-1a hash)
+
+@param names 表示順(行優先)の各セルのピース名
+@param len 文字数
+
+@return fingerprint
+*/
+unsigned long long solution_fingerprint(const char* names, const size_t len){
+	uint64_t h = 14695981039346656037ULL;
+	for (size_t i = 0; i < len; i++){
+		h ^= (unsigned char)names[i];
+		h *= 1099511628211ULL;
+	}
+	return h;
+}
+
+/*!
+アーカイブの解のfingerprintを解の番号順に読み出す
+
+@param path アーカイブファイル
+@param fingerprints [out] 解の番号順のfingerprint
+
+@return true:成功
+*/
+bool read_archive_fingerprints(const char* path, vector<unsigned long long>& fingerprints){
+	fingerprints.clear();
+
+	MappedFile file;
+	if (!file.Open(path)) return false;
+
+	if (!validate_archive(file)) return false;
+
+	const archive_header_t* header = (const archive_header_t*)file.data();
+	const archive_index_t* index = (const archive_index_t*)(file.data() + header->index_offset);
+	fingerprints.resize((size_t)header->solution_num);
+	for (uint64_t i = 0; i < header->solution_num; i++) {
+		if (index[i].no >= header->solution_num) return false;
+		fingerprints[(size_t)index[i].no] = index[i].fingerprint;
+	}
+	return true;
+}
+
+/*!
+解のアーカイブの読み出し
+
+@param path アーカイブファイル
+@param no 表示する解の番号 (1 origin, 0:指定なし)
+@param filter 解のフィルタ "X:r:c[,X:r:c...]" ピースXがr行c列を覆う解 (NULL:指定なし)
+	'/'を含む場合は compact形式の解として索引から探す。
+@param print_all 一致する全ての解を表示するか?(otherwise, 最初の解のみ)
+
+@return 一致する解の数 (-1:読み出しエラー)
+*/
+int read_pentomino_archive(const char* path, int no, const char* filter, const bool print_all){
+	MappedFile file;
+	if (!file.Open(path)) {
+		printf("can not open archive: %s\n", path);
+		return -1;
+	}
+
+	if (!validate_archive(file)) {
+		printf("invalid archive: %s\n", path);
+		return -1;
+	}
+
+	const archive_header_t* header = (const archive_header_t*)file.data();
+
+	const int rows = header->rows;
+	const int cols = header->cols;
+	const unsigned char* records = file.data() + header->record_offset;
+	const archive_index_t* index = (const archive_index_t*)(file.data() + header->index_offset);
+	const long long solution_num = (long long)header->solution_num;
+
+	printf("archive rows:%d\tcols:%d\tpieces:%.*s\tsymmetry:%u\n", rows, cols, (int)header->piece_num, header->names, header->symmetry);
+	printf("archive solution_num: %lld\n", solution_num);
+
+	//表示用のピースデータ (色はデータベースから引く)
+	vector<Piece> pieces(header->piece_num);
+	{
+		vector<Piece> db;
+		init_pieces(db, rows, cols, false);
+		for (int i = 0; i < (int)pieces.size(); i++) {
+			memset(&pieces[i], 0, sizeof(Piece));
+			pieces[i].name = header->names[i];
+			for (auto& p : db) {
+				if (p.name == pieces[i].name) memcpy(pieces[i].color, p.color, sizeof(p.color));
+			}
+		}
+	}
+
+	//フィルタの解析
+	vector<pair<int, int>> conds;		//(表示順のセル位置, ピース番号)
+	vector<long long> lookup;			//索引で見つけた解の番号
+	bool use_lookup = false;
+	if (filter) {
+		if (strchr(filter, '/')) {
+			string text;
+			for (const char* c = filter; *c; c++) if (*c != '/') text += *c;
+			use_lookup = true;
+			if ((int)text.size() == rows * cols) {
+				const uint64_t h = solution_fingerprint(text.data(), text.size());
+				const archive_index_t* lo = lower_bound(index, index + solution_num, h,
+					[](const archive_index_t& e, uint64_t v){ return e.fingerprint < v; });
+				for (; lo != index + solution_num && lo->fingerprint == h; ++lo) {
+					const unsigned char* rec = records + lo->no * header->record_size;
+					if (lo->no >= header->solution_num || !validate_record(header, rec)) {
+						printf("invalid archive: %s\n", path);
+						return -1;
+					}
+					bool same = true;
+					for (int i = 0; i < rows * cols && same; i++) {
+						const char name = (rec[i] == ARCHIVE_CELL_EMPTY) ? ' ' : (rec[i] == ARCHIVE_CELL_HOLE) ? '#' : header->names[rec[i]];
+						same = (name == text[i]);
+					}
+					if (same) lookup.push_back((long long)lo->no);
+				}
+				sort(lookup.begin(), lookup.end());
+			}
+		}
+		else {
+			string f(filter);
+			size_t pos = 0;
+			while (pos < f.size()) {
+				size_t end = f.find(',', pos);
+				if (end == string::npos) end = f.size();
+				char name;
+				int r, c;
+				if (sscanf(f.substr(pos, end - pos).c_str(), "%c:%d:%d", &name, &r, &c) != 3 || r < 0 || r >= rows || c < 0 || c >= cols) {
+					printf("invalid filter: %s\n", filter);
+					return -1;
+				}
+				const char* p = (const char*)memchr(header->names, name, header->piece_num);
+				conds.push_back(make_pair(r * cols + c, p ? (int)(p - header->names) : -1));
+				pos = end + 1;
+			}
+		}
+	}
+
+	SolutionWriter writer(pieces, rows, cols, false);
+	vector<int> board = create_board(rows, cols);
+	int match_num = 0;
+
+	//レコードを確かめて表示する (false:壊れたレコード)
+	auto print = [&](long long n) {
+		const unsigned char* rec = records + n * header->record_size;
+		if (!validate_record(header, rec)) {
+			writer.Flush();
+			printf("invalid archive: %s (solution #%lld)\n", path, n + 1);
+			return false;
+		}
+		for (int y = 0; y < rows; y++) {
+			for (int x = 0; x < cols; x++) {
+				const unsigned char v = rec[y * cols + x];
+				board[y * (cols + 1) + x] = (v == ARCHIVE_CELL_EMPTY) ? BOARD_CELL_EMPTY : (v == ARCHIVE_CELL_HOLE) ? BOARD_CELL_BOARDER : v;
+			}
+		}
+		writer.Write(board, (int)(n + 1));
+		return true;
+	};
+
+	if (no > 0) {	//番号指定 (seek)
+		if (no > solution_num) {
+			printf("solution #%d is out of range.\n", no);
+			return 0;
+		}
+		return print(no - 1) ? 1 : -1;
+	}
+
+	if (use_lookup) {
+		for (long long n : lookup) {
+			if ((match_num == 0 || print_all) && !print(n)) return -1;
+			match_num++;
+		}
+	}
+	else {
+		for (long long n = 0; n < solution_num; n++) {
+			const unsigned char* rec = records + n * header->record_size;
+			bool match = true;
+			for (auto& c : conds) {
+				if (rec[c.first] != c.second) { match = false; break; }
+			}
+			if (!match) continue;
+			if (!validate_record(header, rec)) {
+				writer.Flush();
+				printf("invalid archive: %s (solution #%lld)\n", path, n + 1);
+				return -1;
+			}
+
+			if (match_num == 0 || print_all) print(n);
+			match_num++;
+		}
+	}
+	writer.Flush();
+
+	return match_num;
+}
@@ -0,0 +1,401 @@
+﻿/*
+Copyright (c) 2016, oasi-adamay
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+* Neither the name of glsCV nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*!
+@file	constraint.cpp
+@author	oasi-adamay
+@brief	配置条件付きの探索。条件を探索前に盤面と配置表に反映し、探索木を枝狩りする。
+
+条件の書式 "X:r:c[,X:r:c...]" (r,cは表示する盤面の行,列)
+- X:r:c   r行c列をピースXで覆う
+- !X:r:c  r行c列をピースXで覆わない
+- #:r:c   r行c列は穴 (ピースを置かない)
+あるピースの5セル全てを指定した場合、そのピースは探索前に盤面に配置する。
+
+条件によって盤面の対称性が崩れるので、冗長な形状の削除(remove_redundant_shape)は行わない。
+(回転・鏡像による解も別の解として数える)
+*/
+
+//-----------------------------------------------------------------------------
+// generic include
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <assert.h>
+
+#include "pentomino.h"
+#include "pentomino_internal.h"
+
+using namespace std;
+
+//-----------------------------------------------------------------------------
+
+/*!
+配置条件 (探索するボード上の位置で保持する)
+*/
+struct constraint_t {
+	vector<int>			require;	//!< ボード上の位置 -> 覆うピース番号 (-1:指定なし)
+	vector<vector<bool>> forbid;	//!< ピース番号 -> ボード上の位置 -> 覆わない
+	vector<vector<int>>	cells;		//!< ピース番号 -> 覆うボード上の位置の一覧
+	vector<int>			holes;		//!< 穴のボード上の位置の一覧
+	vector<bool>		placed;		//!< ピース番号 -> 事前に配置した
+};
+
+//-----------------------------------------------------------------------------
+// private functions
+
+/*!
+条件の解析
+
+@return false:書式エラー
+*/
+static bool parse_constraint(const char* spec, const vector<Piece>& pieces, int rows, int cols, const bool swap_ij, constraint_t& cs){
+	const int stride_num = cols + 1;
+	const int n = (int)pieces.size();
+
+	cs.require.assign((rows + 1) * stride_num, -1);
+	cs.forbid.assign(n, vector<bool>((rows + 1) * stride_num, false));
+	cs.cells.assign(n, vector<int>());
+	cs.holes.clear();
+
+	string f(spec);
+	size_t pos = 0;
+	while (pos < f.size()) {
+		size_t end = f.find(',', pos);
+		if (end == string::npos) end = f.size();
+		string item = f.substr(pos, end - pos);
+		pos = end + 1;
+
+		bool is_forbid = false;
+		if (!item.empty() && item[0] == '!') { is_forbid = true; item = item.substr(1); }
+
+		char name;
+		int r, c;
+		if (sscanf(item.c_str(), "%c:%d:%d", &name, &r, &c) != 3) return false;
+
+		//表示の行列 -> 探索するボードの行列
+		const int y = swap_ij ? c : r;
+		const int x = swap_ij ? r : c;
+		if (y < 0 || y >= rows || x < 0 || x >= cols) return false;
+		const int idx = y * stride_num + x;
+
+		if (name == '#' && !is_forbid) {
+			cs.holes.push_back(idx);
+			continue;
+		}
+
+		int i = 0;
+		while (i < n && pieces[i].name != name) i++;
+		if (i == n) return false;
+
+		if (is_forbid) {
+			cs.forbid[i][idx] = true;
+		}
+		else if (cs.require[idx] != i) {
+			if (cs.require[idx] >= 0) cs.require[idx] = INT_MAX;	//矛盾 (解なし)
+			else cs.require[idx] = i;
+			cs.cells[i].push_back(idx);
+		}
+	}
+	return true;
+}
+
+/*!
+配置の除外条件
+
+事前に配置したピース、配置の覆うセルが他のピースに指定されている、または禁止されている場合、
+およびピースに指定されたセルを全て覆わない場合は除外する。
+*/
+static bool constraint_filter(const Placement& p, const int anchor, const void* arg){
+	const constraint_t* cs = (const constraint_t*)arg;
+
+	if (cs->placed[p.piece]) return true;
+
+	for (int k = 0; k < PIECE_BLOCK_NUM; k++) {
+		const int idx = anchor + p.offsets[k];
+		if (cs->require[idx] >= 0 && cs->require[idx] != p.piece) return true;
+		if (cs->forbid[p.piece][idx]) return true;
+	}
+	for (int idx : cs->cells[p.piece]) {
+		bool covered = false;
+		for (int k = 0; k < PIECE_BLOCK_NUM; k++) {
+			if (anchor + p.offsets[k] == idx) { covered = true; break; }
+		}
+		if (!covered) return true;
+	}
+	return false;
+}
+
+/*!
+5セル全てを指定されたピースを盤面に配置する。
+
+@return false:配置できない(解なし)
+*/
+static bool preplace_pieces(const vector<Piece>& pieces, const constraint_t& cs, vector<int>& board, vector<bool>& used){
+	for (int i = 0; i < (int)pieces.size(); i++) {
+		vector<int> cells = cs.cells[i];
+		if ((int)cells.size() > PIECE_BLOCK_NUM) return false;
+		if ((int)cells.size() < PIECE_BLOCK_NUM) continue;
+
+		sort(cells.begin(), cells.end());
+		const int anchor = cells[0];
+
+		bool placed = false;
+		for (int j = 0; j < pieces[i].shape_num && !placed; j++) {
+			bool same = true;
+			for (int k = 0; k < PIECE_BLOCK_NUM; k++) {
+				if (anchor + pieces[i].shape[j].offsets[k] != cells[k]) { same = false; break; }
+			}
+			if (!same) continue;
+
+			for (int k = 0; k < PIECE_BLOCK_NUM; k++) {
+				const int idx = cells[k];
+				if (board[idx] != BOARD_CELL_EMPTY || cs.forbid[i][idx]) return false;
+				board[idx] = i;
+			}
+			used[i] = true;
+			placed = true;
+		}
+		if (!placed) return false;
+	}
+	return true;
+}
+
+/*!
+条件に一致する解だけを数える (探索後のフィルタ、比較用)
+*/
+class ConstraintFilter : public SolutionSink {
+public:
+	const constraint_t& cs;
+	int num;
+	ConstraintFilter(const constraint_t& _cs) : cs(_cs), num(0) {}
+	void Push(const vector<int>& board) {
+		for (int i = 0; i < (int)cs.cells.size(); i++) {
+			for (int idx : cs.cells[i]) if (board[idx] != i) return;
+		}
+		for (int i = 0; i < (int)cs.forbid.size(); i++) {
+			for (int idx = 0; idx < (int)board.size(); idx++) if (cs.forbid[i][idx] && board[idx] == i) return;
+		}
+		num++;
+	}
+};
+
+//-----------------------------------------------------------------------------
+// shared functions
+
+/*!
+配置条件付きの探索問題の準備
+
+配置条件を解析し、穴と5セル全てを指定されたピースをボードに配置し、
+配置条件で絞り込んだ配置表を作る。
+
+@param prob		探索問題 (出力)
+@param pieces	ペントミノデータ配列 (冗長な形状を削除していないもの)
+@param base		基準の配置表 (空のボードで生成したもの。NULL:piecesから生成する)
+@param rows		探索するボードの行数
+@param cols		探索するボードの列数
+@param swap_ij	行と列を入れ替えて探索しているか?
+@param spec		配置条件
+
+@return false:条件の書式エラー
+*/
+bool setup_constraint_problem(
+	ConstraintProblem& prob,
+	const vector<Piece>& pieces,
+	const PlacementTable* base,
+	const int rows,
+	const int cols,
+	const bool swap_ij,
+	const char* spec
+)
+{
+	const int piece_num = (int)pieces.size();
+
+	constraint_t cs;
+	if (!parse_constraint(spec, pieces, rows, cols, swap_ij, cs)) return false;
+
+	prob.board = create_board(rows, cols);
+	for (int idx : cs.holes) prob.board[idx] = BOARD_CELL_BOARDER;
+	prob.used.assign(piece_num, false);
+	prob.table.start.clear();
+	prob.table.placement.clear();
+
+	//自明な条件の削除
+	prob.feasible = piece_num*PIECE_BLOCK_NUM <= (int)count(prob.board.begin(), prob.board.end(), BOARD_CELL_EMPTY)
+		&& find(cs.require.begin(), cs.require.end(), INT_MAX) == cs.require.end();
+	for (int idx : cs.holes) {
+		if (cs.require[idx] >= 0) prob.feasible = false;
+	}
+	if (prob.feasible) prob.feasible = preplace_pieces(pieces, cs, prob.board, prob.used);
+
+	prob.remain = (int)count(prob.used.begin(), prob.used.end(), false);
+	prob.cell = 0;
+	while (prob.cell < (int)prob.board.size() && prob.board[prob.cell] != BOARD_CELL_EMPTY) prob.cell++;
+
+	if (prob.feasible) {
+		cs.placed = prob.used;
+		if (base) select_placement_table(prob.table, *base, prob.board, constraint_filter, &cs);
+		else build_placement_table(prob.table, pieces, prob.board, constraint_filter, &cs);
+	}
+	return true;
+}
+
+/*!
+配置条件付きの探索問題を解く
+
+@param prob			探索問題 (探索中はボードを更新し、終了時に戻す)
+@param solution		解のリスト
+@param find_all		全ての解を見つけるか?
+@param stride_num	ボードのstride
+@param call_num		探索ノード数
+
+@return 解の数 (solution に渡した数)
+*/
+int solve_constraint_problem(ConstraintProblem& prob, SolutionSink& solution, const bool find_all, const int stride_num, long long& call_num){
+	if (!prob.feasible) return 0;
+
+	if (prob.cell == (int)prob.board.size()) {
+		if (prob.remain == 0) { solution.Push(prob.board); return 1; }	//全てのピースを事前に配置した
+		return 0;
+	}
+	if (prob.remain == 0) return 0;
+
+	class Counter : public SolutionSink {
+	public:
+		SolutionSink& next;
+		int num;
+		Counter(SolutionSink& _next) : next(_next), num(0) {}
+		void Push(const vector<int>& board) { num++; next.Push(board); }
+		bool Done(void) const { return next.Done(); }
+	} counter(solution);
+
+	vector<int> node(prob.remain + 1, 0);
+	node[prob.remain] = END_OF_NODE;
+	vector<bool> used = prob.used;
+
+	find_solution_table(prob.table, used, &prob.board[0], prob.cell, &node[0], prob.board, counter, find_all, stride_num, call_num);
+	return counter.num;
+}
+
+//-----------------------------------------------------------------------------
+// public functions
+
+/*!
+配置条件付きでペントミノの解を見つける。
+
+@param rows 配置するボードの行数
+@param cols 配置するボードの列数
+@param find_all 全ての解を見つけるか?
+@param print_all 全ての解を表示するか?
+@param swap_ij 行と列を入れ替えて探索しているか?(表示時に戻す)
+@param spec 配置条件
+@param compare 全ての解を探索してから条件で絞り込む場合と、探索ノード数を比較するか?
+
+@return 解の数 (-1:条件の書式エラー)
+*/
+int solve_pentomino_constrained(int rows, int cols, const bool find_all, const bool print_all, const bool swap_ij, const char* spec, const bool compare){
+	assert(rows > 0);
+	assert(cols > 0);
+
+	vector<Piece> pieces;
+	{
+		PhaseTimer phase(PROFILE_INIT_PIECES);
+		init_pieces(pieces, rows, cols, false);
+	}
+	const int piece_num = (int)pieces.size();
+
+	ConstraintProblem prob;
+	bool valid;
+	{
+		PhaseTimer phase(PROFILE_BOARD_SETUP);
+		valid = setup_constraint_problem(prob, pieces, NULL, rows, cols, swap_ij, spec);
+	}
+	if (!valid) {
+		printf("invalid constraint: %s\n", spec);
+		return -1;
+	}
+
+	SolutionList solution(print_all ? INT_MAX : 1);
+	long long call_num = 0;
+	double pushdown_time;
+	{
+		Timer tmr("process time:\t");
+		PhaseTimer phase(PROFILE_SEARCH);
+		PerfCounter counter;
+		auto t0 = chrono::steady_clock::now();
+		counter.Start();
+		solve_constraint_problem(prob, solution, find_all, cols + 1, call_num);
+		counter.Stop();
+		pushdown_time = chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+		profile_add_thread(0, counter, call_num);
+	}
+	g_find_solution_call_num += call_num;
+
+	{	//解の表示
+		PhaseTimer phase(PROFILE_OUTPUT);
+		SolutionWriter writer(pieces, rows, cols, swap_ij);
+		int i = 0;
+		for (auto itr = solution.solution.begin(); itr != solution.solution.end(); ++itr, i++) {
+			writer.Write(*itr, i + 1);
+		}
+	}
+
+	if (compare && find_all) {
+		//全ての解を探索してから、条件で絞り込む
+		vector<bool> used_all(piece_num, false);
+		vector<int>  node_all(piece_num + 1, 0);
+		node_all[piece_num] = END_OF_NODE;
+		vector<int>  board_all = create_board(rows, cols);
+		constraint_t cs;
+		parse_constraint(spec, pieces, rows, cols, swap_ij, cs);
+		for (int idx : cs.holes) board_all[idx] = BOARD_CELL_BOARDER;
+		ConstraintFilter filter(cs);
+
+		const long long call_num_save = g_find_solution_call_num;
+		auto t0 = chrono::steady_clock::now();
+		int cell = 0;
+		while (cell < (int)board_all.size() && board_all[cell] != BOARD_CELL_EMPTY) cell++;
+		if (cell < (int)board_all.size()) {
+			find_solution(pieces, used_all, &board_all[cell], &node_all[0], board_all, filter, true, cols + 1);
+		}
+		const double filter_time = chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+		const long long filter_call_num = g_find_solution_call_num - call_num_save;
+		g_find_solution_call_num = call_num_save;
+
+		printf("filter after search:\tsolution_num: %d\tcall_num: %lld\ttime: %.3f[ms]\n", filter.num, filter_call_num, filter_time);
+		printf("constraint pushdown:\tsolution_num: %d\tcall_num: %lld\ttime: %.3f[ms]\n", solution.num, call_num, pushdown_time);
+		printf("node reduction:\t%.2fx\n", call_num > 0 ? (double)filter_call_num / call_num : 0.0);
+	}
+
+	return solution.num;
+}
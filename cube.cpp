@@ -0,0 +1,820 @@
+﻿/*
+Copyright (c) 2016, oasi-adamay
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+* Neither the name of glsCV nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*!
+@file	cube.cpp
+@author	oasi-adamay
+@brief	立体のペントミノパズル(ペンタキューブで直方体を埋める)の解を求める。
+*/
+
+//-----------------------------------------------------------------------------
+// generic include
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <climits>
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <assert.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include "pentomino.h"
+#include "pentomino_internal.h"
+
+using namespace std;
+
+/*!
+const & define macro
+*/
+#define CUBE_CELL_MAX					128		//max number of cells of the box (bits of the occupancy)
+#define CUBE_TASK_PER_THREAD			64		//number of tasks per thread to split the search tree
+#define CUBE_SPLIT_DEPTH_MAX			4		//max depth to split the search tree
+#define CUBE_REORDER_WINDOW_PER_THREAD	16		//number of tasks in the reorder window per thread
+
+/*!
+平面にないペンタキューブ (17個)
+
+鏡像が回転で重ならないもの(chiral)は片方だけ登録し、その鏡像は小文字の名前の別のピースとする。
+(select_cube_pieces で x を反転して作る)
+*/
+typedef struct {
+	char	name;						//!< piece name (鏡像は小文字)
+	bool	chiral;						//!< 鏡像が回転で重ならないか?
+	int		block[PIECE_BLOCK_NUM][3];	//!< block positions (x, y, z)
+	const char* color;					//!< piece color
+} cube_database_t;
+
+static const cube_database_t cube_database[] = {
+	{ 'A', false, { { 0, 0, 0 }, { 0, 0, 1 }, { 0, 0, 2 }, { 0, 1, 0 }, { 1, 0, 0 } }, "\x1b[41m\x1b[30m" },	//red bk
+	{ 'B', false, { { 0, 0, 0 }, { 0, 0, 1 }, { 0, 0, 2 }, { 0, 1, 1 }, { 1, 0, 1 } }, "\x1b[42m\x1b[30m" },	//green bk
+	{ 'C', false, { { 0, 0, 0 }, { 0, 0, 1 }, { 0, 0, 2 }, { 0, 1, 1 }, { 1, 1, 1 } }, "\x1b[44m\x1b[30m" },	//blue bk
+	{ 'D', false, { { 0, 0, 0 }, { 0, 0, 1 }, { 0, 1, 0 }, { 0, 1, 1 }, { 1, 0, 0 } }, "\x1b[45m\x1b[37m" },	//magenta white
+	{ 'E', false, { { 0, 0, 0 }, { 0, 0, 1 }, { 0, 1, 0 }, { 1, 0, 1 }, { 1, 1, 0 } }, "\x1b[46m\x1b[37m" },	//cyan white
+	{ 'G', true,  { { 0, 0, 0 }, { 0, 0, 1 }, { 0, 0, 2 }, { 0, 1, 0 }, { 1, 0, 1 } }, "\x1b[47m\x1b[31m" },	//white red
+	{ 'H', true,  { { 0, 0, 0 }, { 0, 0, 1 }, { 0, 0, 2 }, { 0, 1, 0 }, { 1, 0, 2 } }, "\x1b[47m\x1b[32m" },	//white green
+	{ 'J', true,  { { 0, 0, 0 }, { 0, 0, 1 }, { 0, 0, 2 }, { 0, 1, 0 }, { 1, 1, 0 } }, "\x1b[47m\x1b[34m" },	//white blue
+	{ 'K', true,  { { 0, 0, 0 }, { 0, 0, 1 }, { 0, 1, 0 }, { 1, 0, 1 }, { 1, 0, 2 } }, "\x1b[47m\x1b[35m" },	//white magenta
+	{ 'M', true,  { { 0, 0, 0 }, { 0, 0, 1 }, { 0, 1, 1 }, { 0, 1, 2 }, { 1, 0, 1 } }, "\x1b[47m\x1b[36m" },	//white cyan
+	{ 'Q', true,  { { 0, 0, 0 }, { 0, 0, 1 }, { 0, 1, 1 }, { 1, 1, 1 }, { 1, 1, 2 } }, "\x1b[47m\x1b[30m" },	//white bk
+};
+
+//-----------------------------------------------------------------------------
+
+/*!
+128bitのセルの集合 (直方体のセルの占有状態)
+
+セルの番号 i は、i<64 なら lo の i bit目、それ以外は hi の (i-64) bit目。
+*/
+struct Bits128 {
+	unsigned long long lo;
+	unsigned long long hi;
+};
+
+static inline Bits128 bits_or(const Bits128& a, const Bits128& b){
+	Bits128 r = { a.lo | b.lo, a.hi | b.hi };
+	return r;
+}
+
+static inline bool bits_overlap(const Bits128& a, const Bits128& b){
+	return ((a.lo & b.lo) | (a.hi & b.hi)) != 0;
+}
+
+/*!
+a の中に b に含まれないセルがあるか?
+*/
+static inline bool bits_any_outside(const Bits128& a, const Bits128& b){
+	return ((a.lo & ~b.lo) | (a.hi & ~b.hi)) != 0;
+}
+
+static inline void bits_set(Bits128& a, const int i){
+	if (i < 64) a.lo |= 1ULL << i;
+	else a.hi |= 1ULL << (i - 64);
+}
+
+static inline bool bits_less(const Bits128& a, const Bits128& b){
+	return (a.hi != b.hi) ? (a.hi < b.hi) : (a.lo < b.lo);
+}
+
+static inline bool bits_equal(const Bits128& a, const Bits128& b){
+	return a.lo == b.lo && a.hi == b.hi;
+}
+
+static inline int ctz64(const unsigned long long v){
+#ifdef _MSC_VER
+	unsigned long idx;
+	_BitScanForward64(&idx, v);
+	return (int)idx;
+#else
+	return __builtin_ctzll(v);
+#endif
+}
+
+static inline Bits128 bits_shift_down(const Bits128& a, const int k){
+	Bits128 r = { (a.lo >> k) | (a.hi << (64 - k)), a.hi >> k };
+	return r;
+}
+
+static inline Bits128 bits_shift_up(const Bits128& a, const int k){
+	Bits128 r = { a.lo << k, (a.hi << k) | (a.lo >> (64 - k)) };
+	return r;
+}
+
+/*!
+最初の空きセル (空きセルがあること)
+*/
+static inline int bits_first_zero(const Bits128& a){
+	return (~a.lo) ? ctz64(~a.lo) : 64 + ctz64(~a.hi);
+}
+
+
+/*!
+ピースの配置 (アンカーセルに置ける、ピース・向き・位置の組)
+*/
+struct CubePlacement {
+	int		piece;		//!< ピースの番号
+	int		sym;		//!< 配置を変えない直方体の対称変換 (stab の番号, -1:なし)
+	Bits128	mask;		//!< ピースが覆うセル
+};
+
+/*!
+立体のパズルの問題 (直方体と配置表)
+
+直方体の辺の長さを昇順に並べ替え、短い辺(x)から順にセルに番号を付ける。
+(平面の探索で縦長のボードにするのと同じく、最初の空きセルを短い辺の方向に進めた方が効率よく枝狩りできる)
+配置表は、配置が覆う最小の番号のセル(アンカーセル)毎に、ピース・向きの順に並べる。
+*/
+struct CubeProblem {
+	int							dim[3];		//!< 辺の長さ (x <= y <= z)
+	int							cell_num;	//!< セルの数
+	vector<PieceBlocks>			pieces;		//!< ピース (向きの数の少ない順)
+	vector<int>					start;		//!< セル c の配置は placement[start[c]] 〜 placement[start[c+1]-1]
+	vector<CubePlacement>		placement;	//!< 配置表
+	vector<Bits128>				neighbor;	//!< セルの +x,+y,+z 方向の隣接セル
+	bool						exact;		//!< 直方体をちょうど埋めるか? (孤立した空きセルがあれば解はない)
+	int							stride[3];	//!< x,y,z 方向の隣のセルとの番号の差
+	Bits128						has_next[3];	//!< x,y,z 方向の + 側に隣接セルがあるセル
+	Bits128						has_prev[3];	//!< x,y,z 方向の - 側に隣接セルがあるセル
+	Bits128						outside;	//!< 直方体の外のビット (占有済みとして扱う)
+	int							sym_piece;	//!< 対称性除去で配置を絞り込んだピース (-1:なし)
+	vector<vector<int>>			perm;		//!< 直方体の対称変換 (恒等変換を除く) によるセルの移り先
+	vector<vector<int>>			stab;		//!< 配置を変えない対称変換 (perm の番号) の組
+};
+
+/*!
+探索の状態 (スレッド毎)
+*/
+struct CubeSearch {
+	const CubeProblem&				prob;
+	vector<bool>					used;		//!< 使用済みのピース
+	vector<const CubePlacement*>	placed;		//!< 配置したピース
+	vector<int>						board;		//!< 解のボード (セル毎のピースの番号)
+	vector<int>						image;		//!< 対称変換したボード
+	long long						call_num;
+
+	CubeSearch(const CubeProblem& _prob)
+		: prob(_prob), used(_prob.pieces.size(), false), board(_prob.cell_num), image(_prob.cell_num), call_num(0) {}
+};
+
+
+
+//-----------------------------------------------------------------------------
+// problem setup
+
+typedef array<int, 3> Coord3;
+
+/*!
+ピースの選択
+
+平面のペントミノ(12個)と平面にないペンタキューブ(17個)から、名前で選ぶ。(選んだ順ではなく、登録順に並べる)
+鏡像を使う場合は、chiralなピースとその鏡像は同じピースなので、どちらか一方しか選べない。
+
+@param names ピースの名前の列 (NULL:平面のペントミノ12個)
+@param mirror ピースの鏡像を使うか?
+@param blocks 選んだピース
+@return false:名前の誤り・重複
+*/
+static bool select_cube_pieces(const char* names, const bool mirror, vector<PieceBlocks>& blocks)
+{
+	init_piece_blocks(blocks);
+	if (names == NULL) return true;
+
+	//全てのピース (chiralなピースの鏡像は、xを反転したもの)
+	vector<PieceBlocks> all(blocks);
+	vector<int> free_no;		//鏡像を同じとみなしたピースの番号
+	for (int i = 0; i < (int)all.size(); i++) free_no.push_back(i);
+	for (const auto& db : cube_database){
+		for (int m = 0; m < (db.chiral ? 2 : 1); m++){
+			PieceBlocks b;
+			b.name = m ? (char)tolower(db.name) : db.name;
+#ifdef PRINT_COLOR_PIECE
+			snprintf(b.color, sizeof(b.color), "%s", db.color);
+#else
+			b.color[0] = '\0';
+#endif
+			for (int k = 0; k < PIECE_BLOCK_NUM; k++){
+				for (int i = 0; i < 3; i++) b.block[k][i] = (m && i == 0) ? -db.block[k][i] : db.block[k][i];
+			}
+			all.push_back(b);
+			free_no.push_back(m ? free_no.back() : (int)free_no.size());
+		}
+	}
+
+	vector<bool> chosen(all.size(), false);
+	vector<bool> chosen_free(all.size(), false);
+	for (const char* c = names; *c; c++){
+		int i = 0;
+		while (i < (int)all.size() && all[i].name != *c) i++;
+		if (i == (int)all.size() || chosen[i]) return false;
+		if (mirror && chosen_free[free_no[i]]) return false;
+		chosen[i] = true;
+		chosen_free[free_no[i]] = true;
+	}
+
+	blocks.clear();
+	for (int i = 0; i < (int)all.size(); i++){
+		if (chosen[i]) blocks.push_back(all[i]);
+	}
+	return !blocks.empty();
+}
+
+/*!
+ピースの向き (回転24通り、鏡像を使う場合は48通り)
+
+軸の置換と符号反転の組 (48通り) のうち、行列式が +1 のもの。(鏡像を使う場合は全て)
+平面のピースの鏡像は、ピースの面を裏返す回転で得られるので、回転だけで全ての向きを尽くす。
+重複する向きは除く。
+
+@param src ピースのブロックの座標
+@param mirror 鏡像の向きも加えるか?
+@param orient 向き毎のブロックの座標 (最小の座標が原点、座標の昇順)
+*/
+static void rotate_piece_blocks(const PieceBlocks& src, const bool mirror, vector<vector<Coord3>>& orient)
+{
+	orient.clear();
+	int axis[3] = { 0, 1, 2 };
+	do {
+		const int parity = (axis[0] > axis[1]) + (axis[0] > axis[2]) + (axis[1] > axis[2]);
+		for (int sign = 0; sign < 8; sign++){
+			const int flip = (sign & 1) + ((sign >> 1) & 1) + ((sign >> 2) & 1);
+			if (!mirror && ((parity + flip) & 1)) continue;		//鏡像
+
+			vector<Coord3> blocks(PIECE_BLOCK_NUM);
+			Coord3 low = { INT_MAX, INT_MAX, INT_MAX };
+			for (int k = 0; k < PIECE_BLOCK_NUM; k++){
+				for (int i = 0; i < 3; i++){
+					const int v = src.block[k][axis[i]];
+					blocks[k][i] = (sign >> i & 1) ? -v : v;
+					low[i] = min(low[i], blocks[k][i]);
+				}
+			}
+			for (auto& b : blocks){
+				for (int i = 0; i < 3; i++) b[i] -= low[i];
+			}
+			sort(blocks.begin(), blocks.end(), [](const Coord3& a, const Coord3& b){
+				return (a[2] != b[2]) ? a[2] < b[2] : (a[1] != b[1]) ? a[1] < b[1] : a[0] < b[0];
+			});
+			if (find(orient.begin(), orient.end(), blocks) == orient.end()) orient.push_back(blocks);
+		}
+	} while (next_permutation(axis, axis + 3));
+}
+
+/*!
+直方体の対称変換
+
+辺の長さが等しい軸の置換と、軸の反転の組。(恒等変換を除く)
+ピースの組が鏡像で閉じている場合(平面のピースだけ、または鏡像を使う場合)は、鏡映も対称変換として使う。
+(鏡映した解では、chiralなピースが鏡像の別のピースに変わるので、そうでなければ回転だけ)
+
+@param prob 問題 (dim, cell_num を設定済み)
+@param reflect 鏡映も使うか?
+*/
+static void build_box_symmetry(CubeProblem& prob, const bool reflect)
+{
+	const int* dim = prob.dim;
+	prob.perm.clear();
+
+	int axis[3] = { 0, 1, 2 };
+	do {
+		if (dim[axis[0]] != dim[0] || dim[axis[1]] != dim[1] || dim[axis[2]] != dim[2]) continue;
+		const int parity = (axis[0] > axis[1]) + (axis[0] > axis[2]) + (axis[1] > axis[2]);
+		for (int sign = 0; sign < 8; sign++){
+			if (sign == 0 && axis[0] == 0 && axis[1] == 1 && axis[2] == 2) continue;	//恒等変換
+			const int flip = (sign & 1) + ((sign >> 1) & 1) + ((sign >> 2) & 1);
+			if (!reflect && ((parity + flip) & 1)) continue;		//鏡映
+
+			vector<int> perm(prob.cell_num);
+			for (int z = 0; z < dim[2]; z++){
+				for (int y = 0; y < dim[1]; y++){
+					for (int x = 0; x < dim[0]; x++){
+						const int src[3] = { x, y, z };
+						int dst[3];
+						for (int i = 0; i < 3; i++){
+							const int v = src[axis[i]];
+							dst[i] = (sign >> i & 1) ? dim[i] - 1 - v : v;
+						}
+						perm[(z*dim[1] + y)*dim[0] + x] = (dst[2] * dim[1] + dst[1])*dim[0] + dst[0];
+					}
+				}
+			}
+			prob.perm.push_back(perm);
+		}
+	} while (next_permutation(axis, axis + 3));
+}
+
+static Bits128 transform_mask(const Bits128& mask, const vector<int>& perm)
+{
+	Bits128 dst = { 0, 0 };
+	for (int c = 0; c < (int)perm.size(); c++){
+		const bool on = (c < 64) ? (mask.lo >> c & 1) : (mask.hi >> (c - 64) & 1);
+		if (on) bits_set(dst, perm[c]);
+	}
+	return dst;
+}
+
+/*!
+問題の初期化 (ピースの向き、配置表、隣接セル、対称性除去)
+
+対称性除去は、向きの数が最も多いピースの配置を、直方体の対称変換による像のうち最小のもの(代表)に限る。
+代表の配置が対称変換で変わらない場合は、同じ解の像が複数見つかるので、解を見つけた時に
+その対称変換による像と比較して、最小のものだけを数える。(setup_cube_problem / push_cube_solution)
+直方体をちょうど埋める場合だけ行う。(空きセルが残る場合は、解の像が解になるとは限らない)
+
+@param blocks ピース (select_cube_pieces)
+@param mirror ピースの鏡像を使うか?
+@return false:セルの数が上限を超える
+*/
+static bool setup_cube_problem(CubeProblem& prob, const int rows, const int cols, const int layers, const vector<PieceBlocks>& blocks, const bool mirror)
+{
+	int dim[3] = { rows, cols, layers };
+	sort(dim, dim + 3);
+	for (int i = 0; i < 3; i++) prob.dim[i] = dim[i];
+	prob.cell_num = dim[0] * dim[1] * dim[2];
+	if (prob.cell_num > CUBE_CELL_MAX) return false;
+
+	prob.outside.lo = prob.outside.hi = 0;
+	for (int c = prob.cell_num; c < CUBE_CELL_MAX; c++) bits_set(prob.outside, c);
+
+	prob.neighbor.assign(prob.cell_num, Bits128{ 0, 0 });
+	prob.stride[0] = 1;
+	prob.stride[1] = dim[0];
+	prob.stride[2] = dim[0] * dim[1];
+	for (int i = 0; i < 3; i++) prob.has_next[i] = prob.has_prev[i] = Bits128{ 0, 0 };
+	for (int z = 0; z < dim[2]; z++){
+		for (int y = 0; y < dim[1]; y++){
+			for (int x = 0; x < dim[0]; x++){
+				Bits128& n = prob.neighbor[(z*dim[1] + y)*dim[0] + x];
+				if (x + 1 < dim[0]) bits_set(n, (z*dim[1] + y)*dim[0] + x + 1);
+				if (y + 1 < dim[1]) bits_set(n, (z*dim[1] + y + 1)*dim[0] + x);
+				if (z + 1 < dim[2]) bits_set(n, ((z + 1)*dim[1] + y)*dim[0] + x);
+
+				const int c = (z*dim[1] + y)*dim[0] + x;
+				const int pos[3] = { x, y, z };
+				for (int i = 0; i < 3; i++){
+					if (pos[i] + 1 < dim[i]) bits_set(prob.has_next[i], c);
+					if (pos[i] > 0) bits_set(prob.has_prev[i], c);
+				}
+			}
+		}
+	}
+
+	//ピースの向き (向きの数の少ない順に並べる)
+	//鏡像の向きを加えても向きが増えないピースは、鏡像が回転で重なる
+	vector<vector<vector<Coord3>>> orient(blocks.size());
+	bool reflect = true;
+	for (int i = 0; i < (int)blocks.size(); i++){
+		vector<vector<Coord3>> both;
+		rotate_piece_blocks(blocks[i], true, both);
+		rotate_piece_blocks(blocks[i], mirror, orient[i]);
+		if (both.size() != orient[i].size()) reflect = false;
+	}
+
+	vector<int> order(blocks.size());
+	for (int i = 0; i < (int)order.size(); i++) order[i] = i;
+	stable_sort(order.begin(), order.end(), [&](int a, int b){ return orient[a].size() < orient[b].size(); });
+
+	prob.pieces.clear();
+	for (int i : order) prob.pieces.push_back(blocks[i]);
+	const int piece_num = (int)prob.pieces.size();
+
+	prob.exact = (prob.cell_num == piece_num * PIECE_BLOCK_NUM);
+	prob.sym_piece = -1;
+	prob.perm.clear();
+	prob.stab.clear();
+	if (prob.exact) {
+		build_box_symmetry(prob, reflect);
+		prob.sym_piece = piece_num - 1;
+	}
+
+	//配置表
+	vector<vector<CubePlacement>> table(prob.cell_num);
+	for (int n = 0; n < piece_num; n++){
+		for (const auto& shape : orient[order[n]]){
+			Coord3 size = { 0, 0, 0 };
+			for (const auto& b : shape){
+				for (int i = 0; i < 3; i++) size[i] = max(size[i], b[i] + 1);
+			}
+			for (int z = 0; z + size[2] <= dim[2]; z++){
+				for (int y = 0; y + size[1] <= dim[1]; y++){
+					for (int x = 0; x + size[0] <= dim[0]; x++){
+						CubePlacement p;
+						p.piece = n;
+						p.sym = -1;
+						p.mask.lo = p.mask.hi = 0;
+						int anchor = INT_MAX;
+						for (const auto& b : shape){
+							const int c = ((z + b[2])*dim[1] + (y + b[1]))*dim[0] + (x + b[0]);
+							bits_set(p.mask, c);
+							anchor = min(anchor, c);
+						}
+
+						if (n == prob.sym_piece){
+							bool is_rep = true;
+							vector<int> stab;
+							for (int g = 0; g < (int)prob.perm.size(); g++){
+								const Bits128 image = transform_mask(p.mask, prob.perm[g]);
+								if (bits_less(image, p.mask)) { is_rep = false; break; }
+								if (bits_equal(image, p.mask)) stab.push_back(g);
+							}
+							if (!is_rep) continue;
+							if (!stab.empty()){
+								auto itr = find(prob.stab.begin(), prob.stab.end(), stab);
+								p.sym = (int)(itr - prob.stab.begin());
+								if (itr == prob.stab.end()) prob.stab.push_back(stab);
+							}
+						}
+						table[anchor].push_back(p);
+					}
+				}
+			}
+		}
+	}
+
+	prob.start.assign(prob.cell_num + 1, 0);
+	prob.placement.clear();
+	for (int c = 0; c < prob.cell_num; c++){
+		prob.start[c] = (int)prob.placement.size();
+		prob.placement.insert(prob.placement.end(), table[c].begin(), table[c].end());
+	}
+	prob.start[prob.cell_num] = (int)prob.placement.size();
+	return true;
+}
+
+
+//-----------------------------------------------------------------------------
+// search
+
+/*!
+探索を続けても解がないか? (枝狩り)
+
+最初の空きセルより前のセルは全て埋まっているので、最初の空きセルの +x,+y,+z 方向の隣接セルが
+全て埋まっていれば、そのセルは孤立していて覆えない。
+直方体をちょうど埋める場合は、6方向の隣接セルが全て埋まっている空きセルがどこかにあれば解はない。
+(空きセルの集合をシフトして、隣接セルが空いているセルを求める)
+*/
+static inline bool is_dead_end(const CubeProblem& prob, const Bits128& occ)
+{
+	if (!prob.exact) return !bits_any_outside(prob.neighbor[bits_first_zero(occ)], occ);
+
+	const Bits128 empty = { ~occ.lo, ~occ.hi };
+	Bits128 adj = { 0, 0 };
+	for (int i = 0; i < 3; i++){
+		const Bits128 next = bits_shift_down(empty, prob.stride[i]);
+		const Bits128 prev = bits_shift_up(empty, prob.stride[i]);
+		adj.lo |= (next.lo & prob.has_next[i].lo) | (prev.lo & prob.has_prev[i].lo);
+		adj.hi |= (next.hi & prob.has_next[i].hi) | (prev.hi & prob.has_prev[i].hi);
+	}
+	return bits_any_outside(empty, adj);
+}
+
+/*!
+解の受け取り
+
+対称性除去したピースの配置が対称変換で変わらない場合は、その対称変換による解の像と比較して、
+最小(セル毎のピースの番号の辞書順)でなければ数えない。
+
+@return true:解を受け取った
+*/
+static bool push_cube_solution(CubeSearch& s, SolutionSink& solution)
+{
+	const CubeProblem& prob = s.prob;
+	fill(s.board.begin(), s.board.end(), BOARD_CELL_EMPTY);
+	int sym = -1;
+	for (const CubePlacement* p : s.placed){
+		for (int c = 0; c < prob.cell_num; c++){
+			const bool on = (c < 64) ? (p->mask.lo >> c & 1) : (p->mask.hi >> (c - 64) & 1);
+			if (on) s.board[c] = p->piece;
+		}
+		if (p->piece == prob.sym_piece) sym = p->sym;
+	}
+
+	if (sym >= 0){
+		for (int g : prob.stab[sym]){
+			const vector<int>& perm = prob.perm[g];
+			for (int c = 0; c < prob.cell_num; c++) s.image[perm[c]] = s.board[c];
+			if (lexicographical_compare(s.image.begin(), s.image.end(), s.board.begin(), s.board.end())) return false;
+		}
+	}
+
+	solution.Push(s.board);
+	return true;
+}
+
+/*!
+最初の空きセルを覆う配置の探索
+
+@param s 探索の状態
+@param occ 埋まっているセル
+@param remain 配置するピースの数
+@param solution 解の受け取り先
+@param find_all 全ての解を見つけるか?
+
+@return true:探索を終了する (解を見つけた(!find_all)、または solution.Done())
+*/
+static bool search_cube(CubeSearch& s, const Bits128& occ, const int remain, SolutionSink& solution, const bool find_all)
+{
+	s.call_num++;
+
+	const CubeProblem& prob = s.prob;
+	const int cell = bits_first_zero(occ);
+	const CubePlacement* p = &prob.placement[prob.start[cell]];
+	const CubePlacement* end = &prob.placement[0] + prob.start[cell + 1];
+	for (; p != end; p++){
+		if (s.used[p->piece]) continue;
+		if (bits_overlap(p->mask, occ)) continue;
+
+		const Bits128 next = bits_or(occ, p->mask);
+		s.used[p->piece] = true;
+		s.placed.push_back(p);
+
+		bool done = false;
+		if (remain == 1){
+			if (push_cube_solution(s, solution)) done = !find_all || solution.Done();
+		}
+		else if (!is_dead_end(prob, next)){
+			done = search_cube(s, next, remain - 1, solution, find_all);
+		}
+
+		s.placed.pop_back();
+		s.used[p->piece] = false;
+		if (done) return true;
+	}
+	return false;
+}
+
+/*!
+探索木の分割 (深さ depth までの配置の列を、探索順に列挙する)
+
+@param tasks 分割した部分木の根までの配置の列 (NULL:数えるだけ)
+@param call_num 分割した部分木より浅いノードの数
+
+@return 部分木の数
+*/
+static int split_cube_tasks(CubeSearch& s, const Bits128& occ, const int depth, vector<vector<int>>* tasks, long long& call_num)
+{
+	if ((int)s.placed.size() == depth){
+		if (tasks){
+			vector<int> task;
+			for (const CubePlacement* p : s.placed) task.push_back((int)(p - &s.prob.placement[0]));
+			tasks->push_back(task);
+		}
+		return 1;
+	}
+	call_num++;
+
+	const CubeProblem& prob = s.prob;
+	const int cell = bits_first_zero(occ);
+	int num = 0;
+	for (int i = prob.start[cell]; i < prob.start[cell + 1]; i++){
+		const CubePlacement* p = &prob.placement[i];
+		if (s.used[p->piece]) continue;
+		if (bits_overlap(p->mask, occ)) continue;
+
+		const Bits128 next = bits_or(occ, p->mask);
+		if (is_dead_end(prob, next)) continue;
+
+		s.used[p->piece] = true;
+		s.placed.push_back(p);
+		num += split_cube_tasks(s, next, depth, tasks, call_num);
+		s.placed.pop_back();
+		s.used[p->piece] = false;
+	}
+	return num;
+}
+
+/*!
+worker thread
+*/
+static void cube_worker(
+	const int id,
+	const CubeProblem& prob,
+	const vector<vector<int>>& tasks,
+	const bool find_all,
+	atomic<int>& next_task,
+	ReorderBuffer& reorder,
+	atomic<long long>& total_call_num
+)
+{
+	CubeSearch s(prob);
+	const int piece_num = (int)prob.pieces.size();
+
+	PerfCounter counter;
+	counter.Start();
+	for (;;) {
+		const int t = next_task.fetch_add(1);
+		if (t >= (int)tasks.size()) break;
+		if (!reorder.Acquire(t)) break;		//先に解が見つかった (!find_all)
+
+		TaskSink solution(reorder, t);
+		Bits128 occ = prob.outside;
+		for (int i : tasks[t]){
+			const CubePlacement* p = &prob.placement[i];
+			occ = bits_or(occ, p->mask);
+			s.used[p->piece] = true;
+			s.placed.push_back(p);
+		}
+		search_cube(s, occ, piece_num - (int)tasks[t].size(), solution, find_all);
+		for (int i : tasks[t]) s.used[prob.placement[i].piece] = false;
+		s.placed.clear();
+	}
+	counter.Stop();
+	profile_add_thread(id, counter, s.call_num);
+
+	total_call_num += s.call_num;
+}
+
+
+//-----------------------------------------------------------------------------
+// output
+
+/*!
+解の表示順 (SolutionWriterの出力順)
+
+最も短い辺(x)方向の層を左から順に横に並べて表示する。(各層は y行 z列)
+compact形式では、行を'/'、層を'|'で区切って1行で表示する。
+*/
+static vector<int> cube_print_order(const CubeProblem& prob, const print_format_t format)
+{
+	const int* dim = prob.dim;
+	vector<int> order;
+	if (format == PRINT_FORMAT_COMPACT){
+		for (int x = 0; x < dim[0]; x++){
+			for (int y = 0; y < dim[1]; y++){
+				for (int z = 0; z < dim[2]; z++) order.push_back((z*dim[1] + y)*dim[0] + x);
+				const bool layer_end = (y == dim[1] - 1) && (x < dim[0] - 1);
+				order.push_back(layer_end ? SolutionWriter::ORDER_GAP : SolutionWriter::ORDER_EOL);
+			}
+		}
+	}
+	else {
+		for (int y = 0; y < dim[1]; y++){
+			for (int x = 0; x < dim[0]; x++){
+				if (x) order.push_back(SolutionWriter::ORDER_GAP);
+				for (int z = 0; z < dim[2]; z++) order.push_back((z*dim[1] + y)*dim[0] + x);
+			}
+			order.push_back(SolutionWriter::ORDER_EOL);
+		}
+	}
+	return order;
+}
+
+
+//-----------------------------------------------------------------------------
+// public functions
+
+/*!
+立体のペントミノパズルの解を見つける。(ペンタキューブで直方体を埋める)
+
+@param rows 直方体の辺の長さ
+@param cols 直方体の辺の長さ
+@param layers 直方体の辺の長さ
+@param pieces ピースの名前の列 (NULL:平面のペントミノ12個)
+@param mirror ピースの鏡像を使うか?
+@param find_all 全ての解を見つけるか?
+@param print_all 全ての解を表示するか?
+@param thread_num スレッド数 (0:コア数, -1:並列に探索しない)
+
+@return 解の数 (-1:ピースの名前の誤り)
+*/
+int solve_pentacube(int rows, int cols, int layers, const char* pieces, const bool mirror, const bool find_all, const bool print_all, int thread_num){
+	assert(rows > 0);
+	assert(cols > 0);
+	assert(layers > 0);
+
+	CubeProblem prob;
+	{
+		PhaseTimer phase(PROFILE_INIT_PIECES);
+		vector<PieceBlocks> blocks;
+		if (!select_cube_pieces(pieces, mirror, blocks)){
+			printf("invalid pieces: %s\n", pieces);
+			return -1;
+		}
+		if (!setup_cube_problem(prob, rows, cols, layers, blocks, mirror)){
+			printf("the box must have at most %d cells.\n", CUBE_CELL_MAX);
+			return 0;
+		}
+	}
+	const int piece_num = (int)prob.pieces.size();
+	string names;
+	for (const auto& p : prob.pieces) names += p.name;
+	printf("box:%dx%dx%d\tpieces:%s%s\tplacement_num:%d\tsymmetry:%d\n", prob.dim[0], prob.dim[1], prob.dim[2],
+		names.c_str(), mirror ? " (mirror)" : "", (int)prob.placement.size(), prob.sym_piece < 0 ? 1 : (int)prob.perm.size() + 1);
+
+	//自明な条件の削除
+	if (piece_num*PIECE_BLOCK_NUM > prob.cell_num) return 0;
+
+	SolutionList solution(print_all ? INT_MAX : 1, NULL, find_all ? INT_MAX : 1);
+	{
+		Timer tmr("process time:\t");
+
+		if (thread_num < 0){
+			PhaseTimer phase(PROFILE_SEARCH);
+			CubeSearch s(prob);
+			search_cube(s, prob.outside, piece_num, solution, find_all);
+			g_find_solution_call_num += s.call_num;
+		}
+		else {
+			if (thread_num == 0) thread_num = (int)thread::hardware_concurrency();
+			if (thread_num <= 0) thread_num = 1;
+
+			//タスクの生成 (タスクの数がスレッド数 x CUBE_TASK_PER_THREAD 以上になる深さで分割する)
+			vector<vector<int>> tasks;
+			long long call_num = 0;
+			{
+				PhaseTimer phase(PROFILE_BOARD_SETUP);
+				CubeSearch s(prob);
+				int depth = 1;
+				for (; depth < CUBE_SPLIT_DEPTH_MAX; depth++){
+					long long n = 0;
+					if (split_cube_tasks(s, prob.outside, depth, NULL, n) >= thread_num * CUBE_TASK_PER_THREAD) break;
+				}
+				split_cube_tasks(s, prob.outside, depth, &tasks, call_num);
+				printf("split_depth:%d\ttask_num:%d\n", depth, (int)tasks.size());
+			}
+
+			PhaseTimer phase(PROFILE_SEARCH);
+			ReorderBuffer reorder(solution, thread_num * CUBE_REORDER_WINDOW_PER_THREAD, find_all);
+			atomic<int> next_task(0);
+			atomic<long long> total_call_num(call_num);
+			vector<thread> threads;
+			for (int id = 0; id < thread_num; id++){
+				threads.push_back(thread(cube_worker, id, ref(prob), ref(tasks), find_all, ref(next_task), ref(reorder), ref(total_call_num)));
+			}
+			for (auto& th : threads) th.join();
+
+			g_find_solution_call_num += total_call_num.load();
+		}
+	}
+
+	{	//解の表示
+		PhaseTimer phase(PROFILE_OUTPUT);
+
+		//表示用のピースデータ (名前と色)
+		vector<Piece> pieces(prob.pieces.size());
+		for (int n = 0; n < (int)pieces.size(); n++) {
+			memset(&pieces[n], 0, sizeof(Piece));
+			pieces[n].name = prob.pieces[n].name;
+			memcpy(pieces[n].color, prob.pieces[n].color, sizeof(pieces[n].color));
+		}
+
+		SolutionWriter writer(pieces, cube_print_order(prob, g_print_format));
+		int i = 0;
+		for (auto itr = solution.solution.begin(); itr != solution.solution.end(); ++itr, i++) {
+			writer.Write(*itr, i + 1);
+		}
+	}
+
+	return find_all ? solution.num : min(solution.num, 1);
+}
@@ -0,0 +1,409 @@
+﻿/*
+Copyright (c) 2016, oasi-adamay
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+* Neither the name of glsCV nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*!
+@file	estimate.cpp
+@author	oasi-adamay
+@brief	探索木の大きさの推定(モンテカルロ法)と、並列探索の分割深さの決定。
+*/
+
+//-----------------------------------------------------------------------------
+// generic include
+#include <stdio.h>
+#include <math.h>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <thread>
+#include <assert.h>
+
+#include "pentomino.h"
+#include "pentomino_internal.h"
+
+using namespace std;
+
+/*!
+const & define macro
+*/
+#define ESTIMATE_TASK_PER_THREAD	64		//number of tasks per thread to balance the load
+#define ESTIMATE_SPLIT_DEPTH_MAX	6		//max depth of the search tree to split into tasks
+#define ESTIMATE_SUBTREE_NODES		10000	//average nodes of the random subtrees to search fully
+#define ESTIMATE_TIME_NS			200e6	//time to search the random subtrees [ns]
+#define ESTIMATE_RELIABLE_PROBES	100000	//warn that the standard error is not reliable with fewer probes
+#define ESTIMATE_HEAVY_SHARE		0.05	//warn if a single probe is more than this share of the sum
+
+/*!
+global var. (progress option)
+*/
+int g_progress_interval = 0;
+
+//-----------------------------------------------------------------------------
+// private functions
+
+/*!
+探索木の根から葉までのランダムな降下 (1回の試行)
+
+find_solution_table と同じ順・同じ枝刈りで子ノードを列挙し、その中から一様に1つを選んで降りる。
+深さdのノードの重みは、根からの分岐数の積で、探索木の深さdのノード数の不偏推定値になる。
+
+深さstop_depthのノードに着いた場合は、そこで降下を止める。
+配置したピースは placed に記録してボードに残すので、呼び出し元で restore_placed により戻すこと。
+
+@param cell		根のノードの基準セル (出力:止まったノードの基準セル)
+@param remain	未配置のピースの数 (出力:止まったノードの未配置のピースの数)
+@param level	深さ毎の探索ノード数に重みを加算する
+@param solution	解の数の推定値に重みを加算する
+@param visited	試行で訪れたノード数
+@param placed	配置したピース (基準セル, 配置表の配置番号)
+
+@return 探索ノード数の推定値 (重みの合計)
+*/
+static double probe_tree(
+	const PlacementTable& table,
+	vector<bool>& used,
+	vector<int>& board,
+	int& cell,
+	int& remain,
+	const int stride_num,
+	const int stop_depth,
+	mt19937& rng,
+	vector<double>& level,
+	double& solution,
+	long long& visited,
+	vector<pair<int, int>>& placed
+)
+{
+	vector<pair<int, int>> child;		//(配置表の配置番号, 次の基準セル)
+	double weight = 1.0;
+	double nodes = 0.0;
+
+	for (int depth = 0; depth < stop_depth; depth++){
+		visited++;
+		nodes += weight;
+		level[depth] += weight;
+
+		child.clear();
+		int complete = 0;
+		int* current_board = &board[cell];
+		for (int n = table.start[cell]; n < table.start[cell + 1]; n++){
+			const Placement* p = &table.placement[n];
+			const int i = p->piece;
+			if (used[i]) { n += p->skip - 1; continue; }
+
+			bool can_place = true;
+			for (int k = 1; k < PIECE_BLOCK_NUM; k++){
+				if (current_board[p->offsets[k]] != BOARD_CELL_EMPTY) { can_place = false; break; }
+			}
+			if (!can_place) continue;
+
+			if (remain == 1) { complete++; continue; }
+
+			for (int k = 0; k < PIECE_BLOCK_NUM; k++){ current_board[p->offsets[k]] = i; }
+			int next = cell;
+			while (board[next] != BOARD_CELL_EMPTY){ next++; }
+			if (board[next + 1] == BOARD_CELL_EMPTY || board[next + stride_num] == BOARD_CELL_EMPTY){
+				child.push_back(make_pair(n, next));
+			}
+			for (int k = 0; k < PIECE_BLOCK_NUM; k++){ current_board[p->offsets[k]] = BOARD_CELL_EMPTY; }
+		}
+		solution += weight * complete;
+		if (child.empty()) break;
+
+		const pair<int, int> c = child[uniform_int_distribution<int>(0, (int)child.size() - 1)(rng)];
+		const Placement* p = &table.placement[c.first];
+		for (int k = 0; k < PIECE_BLOCK_NUM; k++){ current_board[p->offsets[k]] = p->piece; }
+		used[p->piece] = true;
+		placed.push_back(make_pair(cell, c.first));
+
+		weight *= (double)child.size();
+		cell = c.second;
+		remain--;
+	}
+	return nodes;
+}
+
+/*!
+probe_tree で配置したピースを取り除く
+*/
+static void restore_placed(const PlacementTable& table, vector<bool>& used, vector<int>& board, vector<pair<int, int>>& placed){
+	for (auto& e : placed){
+		const Placement* p = &table.placement[e.second];
+		for (int k = 0; k < PIECE_BLOCK_NUM; k++){ board[e.first + p->offsets[k]] = BOARD_CELL_EMPTY; }
+		used[p->piece] = false;
+	}
+	placed.clear();
+}
+
+/*!
+ランダムな部分木の全探索
+
+部分木の平均ノード数が ESTIMATE_SUBTREE_NODES 程度になる深さまでランダムに降り、
+その部分木を find_solution_table で全探索する。合計で max_ns または max_nodes を超えるまで繰り返す。
+
+@param call_num		探索ノード数の合計
+@param solution_num	解の数の合計
+
+@return 処理時間[ns]
+*/
+static double search_random_subtrees(
+	const TreeEstimate& estimate,
+	const PlacementTable& table,
+	vector<bool>& used,
+	vector<int>& board,
+	const int cell,
+	const int remain,
+	const int stride_num,
+	const double max_ns,
+	const long long max_nodes,
+	mt19937& rng,
+	long long& call_num,
+	long long& solution_num
+)
+{
+	//部分木の平均ノード数 = (深さd以降のノード数) / (深さdのノード数)
+	const int depth_num = (int)estimate.level.size();
+	int depth = 0;
+	double below = estimate.nodes;
+	while (depth + 1 < depth_num && estimate.level[depth + 1] > 0.0 && below / estimate.level[depth] > ESTIMATE_SUBTREE_NODES){
+		below -= estimate.level[depth];
+		depth++;
+	}
+
+	vector<pair<int, int>> placed;
+	vector<double> level(depth_num, 0.0);
+	vector<int> node(remain + 1, END_OF_NODE);
+	double solution = 0.0;
+	long long visited = 0;
+	SolutionList sink(0);
+
+	const auto start = chrono::steady_clock::now();
+	double ns = 0.0;
+	while (ns < max_ns && call_num < max_nodes){
+		int c = cell, r = remain;
+		probe_tree(table, used, board, c, r, stride_num, depth, rng, level, solution, visited, placed);
+		if ((int)placed.size() == depth && r > 0){
+			for (int n = 0; n < r; n++) node[n] = 0;
+			node[r] = END_OF_NODE;
+			find_solution_table(table, used, &board[0], c, &node[0], board, sink, true, stride_num, call_num);
+		}
+		restore_placed(table, used, board, placed);
+		ns = (double)chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+	}
+	solution_num = sink.num;
+	return ns;
+}
+
+//-----------------------------------------------------------------------------
+
+/*!
+探索木の大きさの推定
+
+現在の状態(基準セルcellのノード)を根とする部分木について、
+ランダムな試行をprobe_num回行い、その平均から探索ノード数・解の数を推定する。
+board, used は試行中に変更するが、戻る時には元に戻っている。
+
+@param estimate		推定値 (出力)
+@param table		配置表
+@param used			ペントミノが使用済かを表すフラグ配列
+@param board		ボード
+@param cell			根のノードの基準セル
+@param remain		未配置のピースの数
+@param stride_num	ボードのstride
+@param probe_num	試行の回数
+@param seed			乱数のseed
+*/
+void estimate_tree(
+	TreeEstimate& estimate,
+	const PlacementTable& table,
+	vector<bool>& used,
+	vector<int>& board,
+	const int cell,
+	const int remain,
+	const int stride_num,
+	const int probe_num,
+	const unsigned int seed
+)
+{
+	assert(probe_num > 0);
+	mt19937 rng(seed);
+
+	estimate.probe_num = probe_num;
+	estimate.solution_num = 0.0;
+	estimate.solution_density = 0.0;
+	estimate.call_num = 0;
+	estimate.level.assign(remain + 1, 0.0);
+
+	double sum = 0.0, sum2 = 0.0;
+	estimate.nodes_max = 0.0;
+	long long visited = 0;
+	vector<pair<int, int>> placed;
+	const auto start = chrono::steady_clock::now();
+	for (int n = 0; n < probe_num; n++){
+		int c = cell, r = remain;
+		const double nodes = probe_tree(table, used, board, c, r, stride_num, INT_MAX, rng, estimate.level, estimate.solution_num, visited, placed);
+		restore_placed(table, used, board, placed);
+		sum += nodes;
+		sum2 += nodes * nodes;
+		estimate.nodes_max = max(estimate.nodes_max, nodes);
+	}
+	const double ns = (double)chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+
+	estimate.nodes = sum / probe_num;
+	estimate.nodes_error = probe_num > 1 ? sqrt(max(0.0, sum2 / probe_num - estimate.nodes * estimate.nodes) / (probe_num - 1)) : 0.0;
+	estimate.solution_num /= probe_num;
+	for (auto& l : estimate.level) l /= probe_num;
+	estimate.node_ns = ns / visited;
+}
+
+/*!
+ランダムな部分木の全探索による推定
+
+estimate_tree の推定値から、部分木の平均ノード数が ESTIMATE_SUBTREE_NODES 程度になる深さを求め、
+その深さのランダムな部分木を合計 max_ns または max_nodes まで全探索して、1ノード当たりの処理時間と解の密度を求める。
+(同じseedで同じ推定値が必要な場合は、max_nodes で打ち切る)
+(試行は子ノードの列挙に探索より手間がかかり、解に着く試行は稀なので、実際の探索で計測する)
+
+@param estimate		estimate_tree の推定値 (node_ns, solution_density を更新する)
+@param max_ns		探索する時間[ns]
+@param max_nodes	探索するノード数
+@param seed			乱数のseed
+
+@return 推定処理時間[s]
+*/
+double estimate_subtrees(
+	TreeEstimate& estimate,
+	const PlacementTable& table,
+	vector<bool>& used,
+	vector<int>& board,
+	const int cell,
+	const int remain,
+	const int stride_num,
+	const double max_ns,
+	const long long max_nodes,
+	const unsigned int seed
+)
+{
+	mt19937 rng(seed);
+	long long call_num = 0;
+	long long solution_num = 0;
+	const double ns = search_random_subtrees(estimate, table, used, board, cell, remain, stride_num, max_ns, max_nodes, rng, call_num, solution_num);
+	estimate.call_num = call_num;
+	if (call_num > 0){
+		estimate.node_ns = ns / call_num;
+		estimate.solution_density = (double)solution_num / call_num;
+	}
+	return estimate.nodes * estimate.node_ns * 1e-9;
+}
+
+/*!
+並列探索の分割深さを決める
+
+スレッド数に対して十分な数のタスク(分割深さのノード数)が得られる、最も浅い深さを選ぶ。
+
+@param estimate		探索木全体の推定値
+@param thread_num	スレッド数
+
+@return 分割深さ (1 - ESTIMATE_SPLIT_DEPTH_MAX)
+*/
+int choose_split_depth(const TreeEstimate& estimate, const int thread_num){
+	const double task_num = (double)max(thread_num, 1) * ESTIMATE_TASK_PER_THREAD;
+	const int depth_max = min(ESTIMATE_SPLIT_DEPTH_MAX, (int)estimate.level.size() - 1);
+
+	int depth = 1;
+	while (depth < depth_max && estimate.level[depth] < task_num) depth++;
+	return depth;
+}
+
+//-----------------------------------------------------------------------------
+// public functions
+
+/*!
+ペントミノの探索木の大きさを推定する。
+
+探索ノード数・解の数・処理時間の推定値と、深さ毎のノード数を表示する。
+(解の数は、対称な解を除いた数)
+
+@param rows 配置するボードの行数
+@param cols 配置するボードの列数
+@param swap_ij 行と列を入れ替えて探索しているか?
+@param probe_num 試行の回数
+@param seed 乱数のseed
+
+@return 探索ノード数の推定値
+*/
+double estimate_pentomino(int rows, int cols, const bool swap_ij, const int probe_num, const unsigned int seed){
+	assert(rows > 0);
+	assert(cols > 0);
+	(void)swap_ij;
+
+	vector<Piece> pieces;
+	init_pieces(pieces, rows, cols);
+	const int piece_num = (int)pieces.size();
+
+	//自明な条件の削除
+	if (piece_num*PIECE_BLOCK_NUM > (rows*cols)) return 0.0;
+
+	vector<int> board = create_board(rows, cols);
+	PlacementTable table;
+	build_placement_table(table, pieces, board);
+	vector<bool> used(piece_num, false);
+
+	TreeEstimate estimate;
+	{
+		Timer tmr("process time:\t");
+		estimate_tree(estimate, table, used, board, 0, piece_num, cols + 1, probe_num, seed);
+	}
+	const double sec = estimate_subtrees(estimate, table, used, board, 0, piece_num, cols + 1, ESTIMATE_TIME_NS, LLONG_MAX, seed);
+
+	int thread_num = (int)thread::hardware_concurrency();
+	if (thread_num <= 0) thread_num = 1;
+
+	printf("probe_num: %d\n", estimate.probe_num);
+	printf("estimated nodes: %.0f (standard error: %.0f)\n", estimate.nodes, estimate.nodes_error);
+
+	//Knuthの推定値は裾の重い分布で、稀な試行が大きな部分木を引き当てるまで過小評価しやすい。
+	//標準誤差も同じ試行から求めるので、試行が少ないと真の誤差を覆わない。
+	const double max_share = estimate.nodes > 0.0 ? estimate.nodes_max / (estimate.nodes * estimate.probe_num) : 0.0;
+	printf("largest probe: %.1f%% of the sum\n", max_share * 100.0);
+	if (estimate.probe_num < ESTIMATE_RELIABLE_PROBES || max_share > ESTIMATE_HEAVY_SHARE){
+		printf("warning: the estimate is heavy-tailed and tends to be low with few probes; the standard error does not bound the error."
+			" (use -E %d or more)\n", max(ESTIMATE_RELIABLE_PROBES, estimate.probe_num * 4));
+	}
+	printf("estimated solutions: %.1f (probes), %.1f (random subtrees)\n", estimate.solution_num, estimate.nodes * estimate.solution_density);
+	printf("estimated time: %.3f [s] (%.1f [ns/node])\n", sec, estimate.node_ns);
+	printf("split depth: %d (threads:%d)\n", choose_split_depth(estimate, thread_num), thread_num);
+	printf("depth\tnodes\n");
+	for (int d = 0; d < (int)estimate.level.size(); d++){
+		if (estimate.level[d] <= 0.0) break;
+		printf("%d\t%.1f\n", d, estimate.level[d]);
+	}
+
+	return estimate.nodes;
+}
@@ -0,0 +1,631 @@
+﻿/*
+Copyright (c) 2016, oasi-adamay
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+* Neither the name of glsCV nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*!
+@file	gate.cpp
+@author	oasi-adamay
+@brief	全ての探索エンジンの差分テストと性能ゲート。
+
+- 各エンジン・スレッド数の解の数を、既知の解の数(回転・鏡像による解を除く)と比べる。
+- 解をアーカイブに書き出せるエンジンと lazy iterator は、解のfingerprint列を逐次探索と比べる。(解の順も一致すること)
+- 回転・鏡像による解を除かないエンジン(配置条件、ピースの在庫、補完サーバ)は、既知の解の数の4倍と比べ、
+  長方形の4つの対称で正規化した解の集合を逐次探索と比べる。
+- 1解・標本を返すエンジン(ポートフォリオ、サンプリング、補完サーバ)は、正規化した解が逐次探索の解にあることを確かめる。
+- 逐次探索の探索速度(nodes/sec, PROFILE_SEARCH の時間)が、基準値のファイルの値の GATE_PERF_RATIO 倍を下回ったら失敗とする。
+  基準値のファイルがなければ失敗とする。基準値は記録のオプションで書き出す。(基準値はマシン毎に作る)
+*/
+
+//-----------------------------------------------------------------------------
+// generic include
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <string>
+#include <vector>
+#include <set>
+#include <algorithm>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "pentomino.h"
+#include "pentomino_internal.h"
+
+using namespace std;
+
+/*!
+const & define macro
+*/
+#define GATE_PERF_RUNS		3			//number of runs to measure the search speed (best of runs)
+#define GATE_PERF_RATIO		0.8			//min ratio of the search speed to the baseline
+#define GATE_ARCHIVE_SUFFIX	".arc"		//suffix of the temporary archive (next to the baseline file)
+#define GATE_PORTFOLIO_WORKERS	2		//number of portfolio workers
+#define GATE_SAMPLE_NUM		20			//number of sampled solutions
+#define GATE_SEED			1			//seed of the portfolio and the sampler
+
+/*!
+既知の解の数のボード
+*/
+typedef struct {
+	int rows;				//!< ボードの行数
+	int cols;				//!< ボードの列数
+	int solution_num;		//!< 解の数 (回転・鏡像による解を除く)
+} gate_board_t;
+
+static const gate_board_t known_boards[] = {
+	{ 6, 10, 2339 },
+	{ 5, 12, 1010 },
+	{ 4, 15, 368 },
+	{ 3, 20, 2 },
+};
+
+/*!
+解をアーカイブに書き出せるエンジン
+*/
+enum gate_engine_kind_t {
+	GATE_ENGINE_SEQUENTIAL,		//!< 逐次探索 (基準)
+	GATE_ENGINE_OMP,			//!< OpenMPによる並列探索
+	GATE_ENGINE_THREAD,			//!< std::threadによる並列探索
+};
+
+typedef struct {
+	const char* name;			//!< 表示名
+	gate_engine_kind_t kind;	//!< エンジン
+	int thread_num;				//!< スレッド数 (GATE_ENGINE_OMP, GATE_ENGINE_THREAD)
+} gate_engine_t;
+
+static const gate_engine_t archive_engines[] = {
+	{ "sequential",	GATE_ENGINE_SEQUENTIAL,	0 },
+	{ "omp:1",		GATE_ENGINE_OMP,		1 },
+	{ "omp:2",		GATE_ENGINE_OMP,		2 },
+	{ "omp:4",		GATE_ENGINE_OMP,		4 },
+	{ "thread:1",	GATE_ENGINE_THREAD,		1 },
+	{ "thread:2",	GATE_ENGINE_THREAD,		2 },
+	{ "thread:4",	GATE_ENGINE_THREAD,		4 },
+};
+
+/*!
+立体の探索のスレッド数 (-1:並列に探索しない, 0:コア数)
+*/
+static const int cube_threads[] = { -1, 0, 1, 2, 4 };
+
+/*!
+テストの結果 (エンジンの出力と混ざらないよう、最後にまとめて表示する)
+*/
+class GateReport {
+private:
+	vector<string> lines;
+public:
+	int fail_num;
+	GateReport(void) : fail_num(0) {}
+
+	void Check(const bool ok, const string& name, const string& detail){
+		if (!ok) fail_num++;
+		lines.push_back(string(ok ? "PASS" : "FAIL") + "\t" + name + "\t" + detail);
+	}
+
+	void Print(void){
+		printf("---- test report ----\n");
+		for (auto& l : lines) printf("%s\n", l.c_str());
+		printf("test: %d checks, %d failed\n", (int)lines.size(), fail_num);
+	}
+};
+
+/*!
+エンジンが表示する解の捕捉
+
+標準出力を一時ファイルに付け替え、Stop で戻して compact形式の解の行を取り出す。
+*/
+class StdoutCapture {
+private:
+	FILE* tmp;
+	int saved;			//!< 元の標準出力 (-1:付け替えていない)
+	int rows;			//!< 表示の行数
+	int cols;			//!< 表示の列数
+	vector<string> texts;
+
+	bool IsSolution(const string& line) const {
+		if ((int)line.size() != rows * (cols + 1) - 1) return false;
+		for (size_t i = 0; i < line.size(); i++) {
+			const bool eol = (i % (cols + 1)) == (size_t)cols;
+			if (eol ? (line[i] != '/') : !isalpha((unsigned char)line[i])) return false;
+		}
+		return true;
+	}
+public:
+	StdoutCapture(const int _rows, const int _cols) : tmp(tmpfile()), saved(-1), rows(_rows), cols(_cols) {
+		fflush(stdout);
+		if (tmp) saved = dup(fileno(stdout));
+		if (saved >= 0) dup2(fileno(tmp), fileno(stdout));
+	}
+	~StdoutCapture(void) {
+		Stop();
+		if (tmp) fclose(tmp);
+	}
+
+	//! 標準出力を戻し、表示された解を返す
+	const vector<string>& Stop(void) {
+		if (saved < 0) return texts;
+		fflush(stdout);
+		dup2(saved, fileno(stdout));
+		close(saved);
+		saved = -1;
+
+		string out;
+		char buf[4096];
+		size_t n;
+		rewind(tmp);
+		while ((n = fread(buf, 1, sizeof(buf), tmp)) > 0) out.append(buf, n);
+
+		size_t pos = 0;
+		while (pos < out.size()) {
+			size_t end = out.find('\n', pos);
+			if (end == string::npos) end = out.size();
+			const string line = out.substr(pos, end - pos);
+			if (IsSolution(line)) texts.push_back(line);
+			pos = end + 1;
+		}
+		return texts;
+	}
+};
+
+//-----------------------------------------------------------------------------
+// private functions
+
+/*!
+fingerprint列の比較
+
+@return 差異の説明 (一致する場合は空文字列)
+*/
+static string compare_fingerprints(const vector<unsigned long long>& ref, const vector<unsigned long long>& fps){
+	if (fps == ref) return "";
+
+	vector<unsigned long long> a(ref), b(fps);
+	sort(a.begin(), a.end());
+	sort(b.begin(), b.end());
+	return (a == b) ? "solution order differs" : "solutions differ";
+}
+
+/*!
+compact形式の解のfingerprint (アーカイブと同じく、行の区切りを除いた表示順のピース名)
+*/
+static unsigned long long text_fingerprint(const string& text){
+	string names(text);
+	names.erase(std::remove(names.begin(), names.end(), '/'), names.end());
+	return solution_fingerprint(names.data(), names.size());
+}
+
+/*!
+compact形式の解の、長方形の4つの対称(恒等、上下反転、左右反転、180度回転)
+
+@param k 対称の番号 (bit0:上下反転, bit1:左右反転)
+*/
+static string transform_solution(const string& text, const int k){
+	vector<string> lines;
+	size_t pos = 0;
+	for (;;) {
+		const size_t end = text.find('/', pos);
+		lines.push_back(text.substr(pos, end - pos));
+		if (end == string::npos) break;
+		pos = end + 1;
+	}
+
+	if (k & 1) reverse(lines.begin(), lines.end());
+	if (k & 2) for (auto& l : lines) reverse(l.begin(), l.end());
+
+	string out;
+	for (auto& l : lines) {
+		if (!out.empty()) out += '/';
+		out += l;
+	}
+	return out;
+}
+
+/*!
+compact形式の解の正規形 (4つの対称のうち、文字列が最小のもの)
+*/
+static string canonical_solution(const string& text){
+	string best = text;
+	for (int k = 1; k < 4; k++) best = min(best, transform_solution(text, k));
+	return best;
+}
+
+/*!
+正規化した解のfingerprintの集合
+*/
+static set<unsigned long long> canonical_fingerprints(const vector<string>& texts){
+	set<unsigned long long> fps;
+	for (auto& t : texts) fps.insert(text_fingerprint(canonical_solution(t)));
+	return fps;
+}
+
+/*!
+正規化した解が、全て逐次探索の解にあるか?
+
+@return 差異の説明 (全てある場合は空文字列)
+*/
+static string check_in_reference(const set<unsigned long long>& ref, const vector<string>& texts){
+	int miss = 0;
+	for (auto& t : texts) {
+		if (ref.count(text_fingerprint(canonical_solution(t))) == 0) miss++;
+	}
+	if (texts.empty()) return "no solution";
+	return miss ? to_string(miss) + " of " + to_string(texts.size()) + " solutions not in sequential" : "";
+}
+
+/*!
+エンジンで全ての解を見つけ、アーカイブから解のfingerprint列を読み出す
+
+@param texts 表示した解 (NULL:表示しない)
+
+@return 解の数 (-1:アーカイブの読み出しエラー)
+*/
+static int run_archive_engine(const gate_engine_t& engine, const int rows, const int cols, const bool swap_ij, const string& path, vector<unsigned long long>& fps, vector<string>* texts){
+	remove(path.c_str());
+
+	const bool print_all = (texts != NULL);
+	StdoutCapture capture(swap_ij ? cols : rows, swap_ij ? rows : cols);
+
+	int num = 0;
+	switch (engine.kind) {
+	case GATE_ENGINE_SEQUENTIAL:
+		num = solve_pentomino(rows, cols, true, print_all, swap_ij, path.c_str());
+		break;
+	case GATE_ENGINE_OMP:
+#ifdef _OPENMP
+		{
+			const int max_threads = omp_get_max_threads();
+			omp_set_num_threads(engine.thread_num);
+			num = solve_pentomino_omp(rows, cols, true, print_all, swap_ij, path.c_str());
+			omp_set_num_threads(max_threads);
+		}
+#else
+		num = solve_pentomino_omp(rows, cols, true, print_all, swap_ij, path.c_str());	//OpenMPなしでは1スレッドで探索する
+#endif
+		break;
+	case GATE_ENGINE_THREAD:
+		num = solve_pentomino_thread(rows, cols, true, print_all, swap_ij, engine.thread_num, false, path.c_str());
+		break;
+	}
+	const vector<string>& printed = capture.Stop();
+	if (texts) *texts = printed;
+
+	const bool ok = read_archive_fingerprints(path.c_str(), fps);
+	remove(path.c_str());
+	return ok ? num : -1;
+}
+
+/*!
+lazy iterator で全ての解を見つけ、解(compact形式)のfingerprint列を作る
+
+@return 解の数
+*/
+static int run_iterator(const int rows, const int cols, const bool swap_ij, vector<unsigned long long>& fps){
+	fps.clear();
+
+	PentominoIterator itr(rows, cols, swap_ij);
+	while (itr.Next()) {
+		fps.push_back(text_fingerprint(itr.Str()));
+	}
+	return itr.Num();
+}
+
+/*!
+補完サーバの応答から解(compact形式)を取り出す
+
+@return 応答の解の数 (-1:エラーの応答)
+*/
+static int parse_server_response(const string& response, vector<string>& texts){
+	texts.clear();
+	if (response.compare(0, 2, "= ") != 0) return -1;
+
+	int num = -1;
+	sscanf(response.c_str(), "= solution_num:%d", &num);
+
+	size_t pos = response.find('\n') + 1;
+	for (;;) {
+		const size_t end = response.find('\n', pos);
+		if (end == string::npos) return -1;
+		const string line = response.substr(pos, end - pos);
+		if (line == ".") break;
+		texts.push_back(line);
+		pos = end + 1;
+	}
+	return num;
+}
+
+/*!
+逐次探索の探索速度の計測 (GATE_PERF_RUNS 回の最速値)
+
+探索の時間は PROFILE_SEARCH の時間 (ピースデータと配置表の準備を含まない)
+
+@return nodes/sec
+*/
+static double measure_speed(const int rows, const int cols, const bool swap_ij){
+	const bool profile = g_profile;
+	g_profile = true;
+
+	double best = 0;
+	for (int i = 0; i < GATE_PERF_RUNS; i++) {
+		g_find_solution_call_num = 0;
+		const long long start = profile_phase_ns(PROFILE_SEARCH);
+		solve_pentomino(rows, cols, true, false, swap_ij);
+		const double sec = (profile_phase_ns(PROFILE_SEARCH) - start) * 1e-9;
+		if (sec > 0) best = max(best, g_find_solution_call_num / sec);
+	}
+
+	g_profile = profile;
+	return best;
+}
+
+/*!
+回転・鏡像による解を除かないエンジンの解の比較
+
+@param name 表示名
+@param expect 解の数の期待値
+@param num エンジンの解の数
+@param texts エンジンの解
+@param ref 逐次探索の正規化した解
+*/
+static void check_all_solutions(GateReport& report, const string& name, const int expect, const int num, const vector<string>& texts, const set<unsigned long long>& ref){
+	report.Check(num == expect, name, "expect:" + to_string(expect) + " solution_num:" + to_string(num));
+
+	const set<unsigned long long> fps = canonical_fingerprints(texts);
+	const bool ok = ((int)texts.size() == expect) && (fps == ref);
+	report.Check(ok, name, ok ? "canonical solutions match sequential" : "canonical solutions differ (" + to_string(texts.size()) + " printed)");
+}
+
+/*!
+ボードの差分テスト
+*/
+static void test_board(GateReport& report, const gate_board_t& b, const string& archive_path){
+	//探索方向が横方向の為、縦長のboardで探索する (mainと同じ)
+	int rows = b.rows;
+	int cols = b.cols;
+	bool swap_ij = false;
+	if (cols > rows) {
+		std::swap(rows, cols);
+		swap_ij = true;
+	}
+
+	char board_name[32];
+	snprintf(board_name, sizeof(board_name), "%dx%d", b.rows, b.cols);
+	char expect[64];
+	snprintf(expect, sizeof(expect), "expect:%d", b.solution_num);
+
+	//解をアーカイブに書き出せるエンジン (先頭の逐次探索を基準にする)
+	vector<unsigned long long> ref;
+	vector<string> ref_texts;
+	for (auto& e : archive_engines) {
+		const bool sequential = (e.kind == GATE_ENGINE_SEQUENTIAL);
+		vector<unsigned long long> fps;
+		const int num = run_archive_engine(e, rows, cols, swap_ij, archive_path, fps, sequential ? &ref_texts : NULL);
+		const string name = string(board_name) + " " + e.name;
+
+		report.Check(num == b.solution_num, name, string(expect) + " solution_num:" + to_string(num));
+		if (num < 0) continue;
+		if (sequential) {
+			ref = fps;
+
+			//表示した解とアーカイブの解の一致 (以降の正規化した解の比較の基準)
+			vector<unsigned long long> text_fps;
+			for (auto& t : ref_texts) text_fps.push_back(text_fingerprint(t));
+			const string diff = compare_fingerprints(ref, text_fps);
+			report.Check(diff.empty(), name, diff.empty() ? "printed solutions match archive" : "printed " + diff);
+			continue;
+		}
+		const string diff = compare_fingerprints(ref, fps);
+		report.Check(diff.empty(), name, diff.empty() ? "fingerprints match sequential" : diff);
+	}
+	const set<unsigned long long> ref_canonical = canonical_fingerprints(ref_texts);
+
+	//lazy iterator
+	{
+		vector<unsigned long long> fps;
+		const int num = run_iterator(rows, cols, swap_ij, fps);
+		const string name = string(board_name) + " iterator";
+		report.Check(num == b.solution_num, name, string(expect) + " solution_num:" + to_string(num));
+		const string diff = compare_fingerprints(ref, fps);
+		report.Check(diff.empty(), name, diff.empty() ? "fingerprints match sequential" : diff);
+	}
+
+	//回転・鏡像による解を除かないエンジン
+	const int raw_num = b.solution_num * 4;
+	{
+		StdoutCapture capture(b.rows, b.cols);
+		const int num = solve_pentomino_constrained(rows, cols, true, true, swap_ij, "", false);
+		check_all_solutions(report, string(board_name) + " constraint", raw_num, num, capture.Stop(), ref_canonical);
+	}
+	{
+		StdoutCapture capture(b.rows, b.cols);
+		const int num = solve_pentomino_subset(rows, cols, true, true, swap_ij, "1");
+		check_all_solutions(report, string(board_name) + " subset:1", raw_num, num, capture.Stop(), ref_canonical);
+	}
+
+	//補完サーバ (表示の行列で要求する)
+	const string request = to_string(b.rows) + " " + to_string(b.cols);
+	{
+		vector<string> texts;
+		const int num = parse_server_response(serve_request(request + " all"), texts);
+		check_all_solutions(report, string(board_name) + " server:all", raw_num, num, texts, ref_canonical);
+	}
+	{
+		vector<string> texts;
+		const int num = parse_server_response(serve_request(request + " first"), texts);
+		const string diff = check_in_reference(ref_canonical, texts);
+		report.Check(num == 1 && texts.size() == 1 && diff.empty(), string(board_name) + " server:first", diff.empty() ? "solution in sequential" : diff);
+	}
+	if (!ref_texts.empty()) {
+		//逐次探索の最初の解の、先頭のピースだけを置いた盤面の補完
+		const string& first = ref_texts[0];
+		string board(first);
+		for (auto& ch : board) {
+			if (ch != '/' && ch != first[0]) ch = '.';
+		}
+
+		//期待値: 逐次探索の解の4つの対称のうち、盤面に合うものの数
+		int expect_num = 0;
+		for (auto& t : ref_texts) {
+			for (int k = 0; k < 4; k++) {
+				const string s = transform_solution(t, k);
+				bool match = true;
+				for (size_t i = 0; i < board.size() && match; i++) {
+					if (board[i] != '.' && board[i] != s[i]) match = false;
+				}
+				if (match) expect_num++;
+			}
+		}
+
+		vector<string> texts;
+		const int num = parse_server_response(serve_request(request + " all " + board), texts);
+		int mismatch = 0;
+		for (auto& t : texts) {
+			for (size_t i = 0; i < board.size(); i++) {
+				if (board[i] != '.' && (i >= t.size() || board[i] != t[i])) { mismatch++; break; }
+			}
+		}
+		const string diff = check_in_reference(ref_canonical, texts);
+		const bool ok = (num == expect_num) && ((int)texts.size() == expect_num) && diff.empty() && mismatch == 0;
+		report.Check(ok, string(board_name) + " server:board", "expect:" + to_string(expect_num) + " solution_num:" + to_string(num)
+			+ (diff.empty() ? "" : " " + diff) + (mismatch ? " " + to_string(mismatch) + " solutions ignore the board" : ""));
+	}
+
+	//1解を返すエンジン
+	{
+		StdoutCapture capture(b.rows, b.cols);
+		const int num = solve_pentomino_portfolio(rows, cols, swap_ij, GATE_PORTFOLIO_WORKERS, GATE_SEED);
+		const vector<string>& texts = capture.Stop();
+		const string diff = check_in_reference(ref_canonical, texts);
+		report.Check(num == 1 && texts.size() == 1 && diff.empty(), string(board_name) + " portfolio", diff.empty() ? "solution in sequential" : diff);
+	}
+	{
+		StdoutCapture capture(b.rows, b.cols);
+		const int num = sample_pentomino(rows, cols, true, swap_ij, GATE_SAMPLE_NUM, GATE_SEED);
+		const vector<string>& texts = capture.Stop();
+		const string diff = check_in_reference(ref_canonical, texts);
+		report.Check(num == GATE_SAMPLE_NUM && (int)texts.size() == num && diff.empty(), string(board_name) + " sample",
+			"samples:" + to_string(num) + (diff.empty() ? " solutions in sequential" : " " + diff));
+	}
+}
+
+/*!
+基準値のファイルの読み出し
+
+@return nodes/sec (0:ファイルがない)
+*/
+static double read_baseline(const char* path){
+	FILE* fp = fopen(path, "r");
+	if (fp == NULL) return 0;
+
+	double speed = 0;
+	if (fscanf(fp, "nodes_per_sec %lf", &speed) != 1) speed = 0;
+	fclose(fp);
+	return speed;
+}
+
+static bool write_baseline(const char* path, const double speed){
+	FILE* fp = fopen(path, "w");
+	if (fp == NULL) return false;
+	fprintf(fp, "nodes_per_sec %.0f\n", speed);
+	fclose(fp);
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// public functions
+
+/*!
+全ての探索エンジンの差分テストと性能ゲート
+
+@param baseline_path 逐次探索の探索速度の基準値のファイル
+@param record 計測値を基準値のファイルに書き出すか?(otherwise, 基準値と比べる)
+
+@return 失敗したテストの数
+*/
+int test_pentomino(const char* baseline_path, const bool record){
+	//エンジンの出力は1解1行にする
+	const print_format_t format = g_print_format;
+	g_print_format = PRINT_FORMAT_COMPACT;
+
+	GateReport report;
+	const string archive_path = string(baseline_path) + GATE_ARCHIVE_SUFFIX;
+
+	//既知の解の数のボード
+	int total = 0;
+	for (auto& b : known_boards) {
+		test_board(report, b, archive_path);
+		total += b.solution_num;
+	}
+
+	//面積60の全ての長方形の一括探索
+	{
+		const int num = sweep_pentomino("60", 0);
+		report.Check(num == total, "60 sweep", "expect:" + to_string(total) + " solution_num:" + to_string(num));
+	}
+
+	//立体 (2x3x10 の箱は12解)
+	for (int thread_num : cube_threads) {
+		const int num = solve_pentacube(2, 3, 10, NULL, false, true, false, thread_num);
+		report.Check(num == 12, "2x3x10 cube thread:" + to_string(thread_num), "expect:12 solution_num:" + to_string(num));
+	}
+
+	//性能ゲート (6x10 の逐次探索)
+	{
+		const gate_board_t& b = known_boards[0];
+		const double speed = measure_speed(b.cols, b.rows, true);
+		char detail[256];
+		if (record) {
+			const bool ok = write_baseline(baseline_path, speed);
+			snprintf(detail, sizeof(detail), "nodes/sec:%.0f (%s baseline: %s)", speed, ok ? "wrote" : "can not write", baseline_path);
+			report.Check(ok, "6x10 performance", detail);
+		}
+		else {
+			const double baseline = read_baseline(baseline_path);
+			if (baseline > 0) {
+				snprintf(detail, sizeof(detail), "nodes/sec:%.0f baseline:%.0f ratio:%.2f (min %.2f)", speed, baseline, speed / baseline, GATE_PERF_RATIO);
+			}
+			else {
+				snprintf(detail, sizeof(detail), "nodes/sec:%.0f (no baseline: %s, record it with -L)", speed, baseline_path);
+			}
+			report.Check(baseline > 0 && speed >= baseline * GATE_PERF_RATIO, "6x10 performance", detail);
+		}
+	}
+
+	g_print_format = format;
+	report.Print();
+	return report.fail_num;
+}
@@ -0,0 +1,262 @@
+﻿/*
+Copyright (c) 2016, oasi-adamay
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+* Neither the name of glsCV nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*!
+@file	iterator.cpp
+@author	oasi-adamay
+@brief	ペントミノの解の列挙。再帰の代わりに探索スタックを持ち、解を1つずつ取り出す。
+*/
+
+//-----------------------------------------------------------------------------
+// generic include
+#include <stdio.h>
+#include <vector>
+#include <string>
+#include <assert.h>
+
+#include "pentomino.h"
+#include "pentomino_internal.h"
+
+using namespace std;
+
+//-----------------------------------------------------------------------------
+
+/*!
+探索スタックのフレーム (find_solution_table の1回の呼び出しに相当)
+*/
+struct IteratorFrame {
+	int cell;		//!< 基準セル
+	int n;			//!< 次に試す配置表の配置番号
+	int placed;		//!< 配置中の配置番号 (-1:配置していない)
+};
+
+/*!
+イテレータの探索状態
+*/
+struct PentominoIterator::State {
+	vector<Piece>			pieces;
+	PlacementTable			table;
+	vector<int>				board;
+	vector<bool>			used;
+	vector<IteratorFrame>	stack;
+	int						stride_num;
+	int						piece_num;
+	int						num;			//!< 取り出した解の数
+	long long				call_num;		//!< 探索ノード数
+	bool					started;
+	bool					finished;
+	SolutionWriter*			writer;			//!< 表示 (g_print_format)
+	SolutionWriter*			compact;		//!< 文字列化 (PRINT_FORMAT_COMPACT)
+	string					str;
+
+	State(void) : stride_num(0), piece_num(0), num(0), call_num(0), started(false), finished(false), writer(NULL), compact(NULL) {}
+	~State(void) { delete writer; delete compact; }
+
+	void Place(const int cell, const int n, const int piece){
+		const Placement* p = &table.placement[n];
+		for (int k = 0; k < PIECE_BLOCK_NUM; k++){ board[cell + p->offsets[k]] = piece; }
+	}
+	void Push(const int cell){
+		IteratorFrame f = { cell, table.start[cell], -1 };
+		stack.push_back(f);
+		call_num++;
+	}
+};
+
+//-----------------------------------------------------------------------------
+// public functions
+
+/*!
+@param rows 配置するボードの行数
+@param cols 配置するボードの列数
+@param swap_ij 行と列を入れ替えて探索しているか?(表示時に戻す)
+*/
+PentominoIterator::PentominoIterator(int rows, int cols, const bool swap_ij) : state(new State)
+{
+	assert(rows > 0);
+	assert(cols > 0);
+
+	init_pieces(state->pieces, rows, cols);
+	state->piece_num = (int)state->pieces.size();
+	state->stride_num = cols + 1;
+	state->board = create_board(rows, cols);
+	state->used.assign(state->piece_num, false);
+	build_placement_table(state->table, state->pieces, state->board);
+
+	state->writer = new SolutionWriter(state->pieces, rows, cols, swap_ij);
+	state->compact = new SolutionWriter(state->pieces, rows, cols, swap_ij, PRINT_FORMAT_COMPACT, NULL);
+
+	//自明な条件の削除
+	if (state->piece_num*PIECE_BLOCK_NUM > (rows*cols)) state->finished = true;
+}
+
+PentominoIterator::~PentominoIterator(void)
+{
+	delete state;
+}
+
+/*!
+次の解まで探索を進める
+
+find_solution_table と同じ順・同じ枝刈りで探索する。
+解を見つけたら、最後のピースを置いたまま戻り、次の呼び出しで取り除いてから探索を再開する。
+
+@return false:これ以上解はない
+*/
+bool PentominoIterator::Next(void)
+{
+	State& s = *state;
+	if (s.finished) return false;
+
+	if (!s.started){
+		s.started = true;
+		int cell = 0;
+		while (s.board[cell] != BOARD_CELL_EMPTY){ cell++; }
+		s.Push(cell);
+	}
+
+	while (!s.stack.empty()){
+		IteratorFrame& f = s.stack.back();
+
+		//修復 restore
+		if (f.placed >= 0){
+			const int i = s.table.placement[f.placed].piece;
+			s.Place(f.cell, f.placed, BOARD_CELL_EMPTY);
+			s.used[i] = false;
+			f.placed = -1;
+		}
+
+		const int* current_board = &s.board[f.cell];
+		const int end = s.table.start[f.cell + 1];
+		int next = -1;
+		for (; f.n < end; f.n++){
+			const Placement* p = &s.table.placement[f.n];
+			const int i = p->piece;
+			if (s.used[i]) { f.n += p->skip - 1; continue; }		//使用済みのピースの配置を飛ばす
+
+			bool can_place = true;
+			for (int k = 1; k < PIECE_BLOCK_NUM; k++){
+				if (current_board[p->offsets[k]] != BOARD_CELL_EMPTY) { can_place = false; break; }
+			}
+			if (!can_place) continue;
+
+			//更新
+			s.Place(f.cell, f.n, i);
+			s.used[i] = true;
+			f.placed = f.n;
+
+			if ((int)s.stack.size() == s.piece_num){
+				f.n++;
+				s.num++;
+				return true;
+			}
+
+			next = f.cell;
+			while (s.board[next] != BOARD_CELL_EMPTY){ next++; }
+			if (s.board[next + 1] == BOARD_CELL_EMPTY || s.board[next + s.stride_num] == BOARD_CELL_EMPTY) { f.n++; break; }
+
+			//修復 restore
+			s.Place(f.cell, f.placed, BOARD_CELL_EMPTY);
+			s.used[i] = false;
+			f.placed = -1;
+			next = -1;
+		}
+
+		if (next >= 0) s.Push(next);	//再帰の代わり (f は無効になる)
+		else s.stack.pop_back();
+	}
+
+	s.finished = true;
+	return false;
+}
+
+/*!
+現在の解の表示 (g_print_format, 標準出力へバッファして書き出す)
+
+Next が true を返した後のみ表示する。(最初の Next の前、Next が false を返した後は何もしない)
+*/
+void PentominoIterator::Print(void)
+{
+	if (state->num > 0 && !state->finished) state->writer->Write(state->board, state->num);
+}
+
+/*!
+現在の解の文字列 (compact形式, 行は'/'区切り)
+
+@return 解の文字列 (次に Next を呼ぶまで有効, 現在の解がない場合は空文字列)
+*/
+const char* PentominoIterator::Str(void)
+{
+	state->compact->Clear();
+	if (state->num > 0 && !state->finished) state->compact->Write(state->board, 0);
+	state->str = state->compact->Str();
+	if (!state->str.empty()) state->str.pop_back();		//改行を除く
+	return state->str.c_str();
+}
+
+/*!
+@return 取り出した解の数
+*/
+int PentominoIterator::Num(void) const
+{
+	return state->num;
+}
+
+/*!
+@return これまでの探索ノード数 (find_solution の呼び出し回数に相当)
+*/
+long long PentominoIterator::CallNum(void) const
+{
+	return state->call_num;
+}
+
+/*!
+ペントミノの解を必要な数だけ見つける。(イテレータによる探索)
+
+@param rows 配置するボードの行数
+@param cols 配置するボードの列数
+@param print_all 全ての解を表示するか?
+@param swap_ij 行と列を入れ替えて探索しているか?(表示時に戻す)
+@param num 取り出す解の数
+
+@return 解の数
+*/
+int solve_pentomino_iterator(int rows, int cols, const bool print_all, const bool swap_ij, const int num)
+{
+	PentominoIterator itr(rows, cols, swap_ij);
+	{
+		Timer tmr("process time:\t");
+		while (itr.Num() < num && itr.Next()){
+			if (print_all || itr.Num() == 1) itr.Print();
+		}
+	}
+	g_find_solution_call_num += itr.CallNum();
+	return itr.Num();
+}
@@ -0,0 +1,553 @@
+﻿/*
+Copyright (c) 2016, oasi-adamay
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+* Neither the name of glsCV nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*!
+@file	parallel.cpp
+@author	oasi-adamay
+@brief	std::threadによる並列探索。(OpenMPを有効にしなくても並列に探索する)
+
+探索木を分割の深さまで展開して部分木(タスク)の一覧を作り、
+各スレッドがタスクの一覧から順にタスクを取り出して探索する。
+分割の深さは、探索木の大きさの推定(estimate.cpp)から、スレッド数に応じて決める。
+解は ReorderBuffer でタスクの番号順に並べ替えるので、逐次探索と同じ順に出力される。
+*/
+
+//-----------------------------------------------------------------------------
+// generic include
+#include <stdio.h>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <assert.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "pentomino.h"
+#include "pentomino_internal.h"
+
+using namespace std;
+
+/*!
+const & define macro
+*/
+#define PARALLEL_ESTIMATE_PROBES	256		//number of probes to estimate the search tree (split depth)
+#define PARALLEL_ESTIMATE_SEED		1		//fixed seed (the split depth does not change between runs)
+#define PROGRESS_TASK_PROBES		16		//number of probes to estimate each task (progress)
+#define REORDER_WINDOW_PER_THREAD	16		//number of tasks in the reorder window per thread
+
+//-----------------------------------------------------------------------------
+
+/*!
+進捗 (完了したタスクの集計)
+
+ワーカーはタスクの完了時にだけ更新する。(探索中のノード毎には共有変数に書き込まない)
+*/
+struct ParallelProgress {
+	vector<double>			task_nodes;		//!< タスク毎の探索ノード数の推定値
+	double					total_nodes;	//!< 探索ノード数の推定値の合計
+	atomic<int>				done_tasks;		//!< 完了したタスクの数
+	atomic<long long>		done_nodes;		//!< 完了したタスクの探索ノード数
+	atomic<long long>		done_estimate;	//!< 完了したタスクの探索ノード数の推定値
+	mutex					mtx;
+	condition_variable		cv;
+	int						running;		//!< 実行中のワーカーの数
+
+	ParallelProgress(void) : total_nodes(0.0), done_tasks(0), done_nodes(0), done_estimate(0), running(0) {}
+};
+
+//-----------------------------------------------------------------------------
+// private functions
+
+/*!
+スレッドをCPUに固定する
+*/
+static void pin_thread(const int cpu){
+#if defined(_WIN32)
+	SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << (cpu % (8 * sizeof(DWORD_PTR))));
+#elif defined(__linux__)
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(cpu % CPU_SETSIZE, &set);
+	pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+	(void)cpu;
+#endif
+}
+
+/*!
+タスクの生成
+
+find_solution_table と同じ順に、探索木を深さdepthまで展開し、部分木の根までの配置をタスクとして列挙する。
+全てのピースを配置した(解の)場合もタスクとする。
+*/
+static void split_tasks(
+	const PlacementTable& table,
+	vector<bool>& used,
+	vector<int>& board,
+	const int cell,
+	const int depth,
+	const int remain,
+	const int stride_num,
+	ParallelTask& prefix,
+	vector<ParallelTask>& tasks,
+	long long& call_num
+)
+{
+	call_num++;
+
+	int* current_board = &board[cell];
+	for (int n = table.start[cell]; n < table.start[cell + 1]; n++){
+		const Placement* p = &table.placement[n];
+		const int i = p->piece;
+		if (used[i]) { n += p->skip - 1; continue; }
+
+		bool can_place = true;
+		for (int k = 1; k < PIECE_BLOCK_NUM; k++){
+			if (current_board[p->offsets[k]] != BOARD_CELL_EMPTY) { can_place = false; break; }
+		}
+		if (!can_place) continue;
+
+		for (int k = 0; k < PIECE_BLOCK_NUM; k++){ current_board[p->offsets[k]] = i; }
+		used[i] = true;
+		prefix.push_back(make_pair(cell, n));
+
+		if (remain == 1){
+			tasks.push_back(prefix);
+		}
+		else{
+			int next = cell;
+			while (board[next] != BOARD_CELL_EMPTY){ next++; }
+			if (board[next + 1] == BOARD_CELL_EMPTY || board[next + stride_num] == BOARD_CELL_EMPTY){
+				if (depth == 1) tasks.push_back(prefix);
+				else split_tasks(table, used, board, next, depth - 1, remain - 1, stride_num, prefix, tasks, call_num);
+			}
+		}
+
+		prefix.pop_back();
+		for (int k = 0; k < PIECE_BLOCK_NUM; k++){ current_board[p->offsets[k]] = BOARD_CELL_EMPTY; }
+		used[i] = false;
+	}
+}
+
+/*!
+worker thread
+
+探索状態(ボード、使用済みフラグ、ノード)はスレッド内で確保・初期化する。
+(first touch で、スレッドの動作するNUMAノードのメモリに配置される)
+CPUに固定する場合は、配置表もスレッド内に複製する。
+*/
+static void parallel_worker(
+	const int id,
+	const bool affinity,
+	const PlacementTable& shared_table,
+	const vector<ParallelTask>& tasks,
+	const int rows,
+	const int cols,
+	const int piece_num,
+	const bool find_all,
+	atomic<int>& next_task,
+	ReorderBuffer& reorder,
+	atomic<long long>& total_call_num,
+	ParallelProgress* progress
+)
+{
+	if (affinity) pin_thread(id);
+
+	PlacementTable local_table;
+	if (affinity) local_table = shared_table;
+	const PlacementTable& table = affinity ? local_table : shared_table;
+
+	const int stride_num = cols + 1;
+	vector<bool> used(piece_num, false);
+	vector<int>  node(piece_num + 1, 0);
+	node[piece_num] = END_OF_NODE;
+	vector<int>  board = create_board(rows, cols);
+	long long call_num = 0;
+
+	PerfCounter counter;
+	counter.Start();
+	for (;;) {
+		const int t = next_task.fetch_add(1);
+		if (t >= (int)tasks.size()) break;
+		if (!reorder.Acquire(t)) break;		//先に解が見つかった (!find_all)
+
+		const long long task_call_num = call_num;
+		{
+			TaskSink solution(reorder, t);
+			search_parallel_task(table, tasks[t], used, &node[0], board, solution, find_all, stride_num, call_num);
+		}
+
+		if (progress){
+			progress->done_nodes.fetch_add(call_num - task_call_num, memory_order_relaxed);
+			progress->done_estimate.fetch_add((long long)progress->task_nodes[t], memory_order_relaxed);
+			progress->done_tasks.fetch_add(1, memory_order_relaxed);
+		}
+	}
+	counter.Stop();
+	profile_add_thread(id, counter, call_num);
+
+	total_call_num += call_num;
+
+	if (progress){
+		lock_guard<mutex> lock(progress->mtx);
+		progress->running--;
+		progress->cv.notify_all();
+	}
+}
+
+/*!
+タスク毎の探索ノード数の推定 (進捗表示用)
+*/
+static void estimate_tasks(
+	const PlacementTable& table,
+	const vector<ParallelTask>& tasks,
+	vector<int>& board,
+	const int piece_num,
+	const int stride_num,
+	ParallelProgress& progress
+)
+{
+	vector<bool> used(piece_num, false);
+	progress.task_nodes.assign(tasks.size(), 1.0);
+	progress.total_nodes = 0.0;
+
+	for (int t = 0; t < (int)tasks.size(); t++){
+		const ParallelTask& task = tasks[t];
+		for (auto& e : task){
+			const Placement* p = &table.placement[e.second];
+			for (int k = 0; k < PIECE_BLOCK_NUM; k++){ board[e.first + p->offsets[k]] = p->piece; }
+			used[p->piece] = true;
+		}
+
+		const int remain = piece_num - (int)task.size();
+		if (remain > 0){
+			int next = task.back().first;
+			while (board[next] != BOARD_CELL_EMPTY){ next++; }
+			TreeEstimate estimate;
+			estimate_tree(estimate, table, used, board, next, remain, stride_num, PROGRESS_TASK_PROBES, PARALLEL_ESTIMATE_SEED + t);
+			progress.task_nodes[t] = estimate.nodes;
+		}
+		else{
+			progress.task_nodes[t] = 0.0;
+		}
+		progress.total_nodes += progress.task_nodes[t];
+
+		for (auto& e : task){
+			const Placement* p = &table.placement[e.second];
+			for (int k = 0; k < PIECE_BLOCK_NUM; k++){ board[e.first + p->offsets[k]] = BOARD_CELL_EMPTY; }
+			used[p->piece] = false;
+		}
+	}
+}
+
+/*!
+進捗の表示 (標準エラー出力)
+
+完了したタスクの推定ノード数の割合から、残りの処理時間(ETA)を求める。
+*/
+static void print_progress(const ParallelProgress& progress, const int task_num, const double sec){
+	const long long done_nodes = progress.done_nodes.load(memory_order_relaxed);
+	const double done_estimate = (double)progress.done_estimate.load(memory_order_relaxed);
+	const double ratio = progress.total_nodes > 0.0 ? min(done_estimate / progress.total_nodes, 1.0) : 0.0;
+
+	fprintf(stderr, "progress: %d/%d tasks	%.1f%%	nodes:%lld	%.0f[nodes/s]",
+		progress.done_tasks.load(memory_order_relaxed), task_num, ratio * 100.0, done_nodes, sec > 0.0 ? done_nodes / sec : 0.0);
+	if (ratio > 0.0) fprintf(stderr, "	ETA:%.1f[s]\n", sec * (1.0 - ratio) / ratio);
+	else fprintf(stderr, "	ETA:-\n");
+}
+
+//-----------------------------------------------------------------------------
+
+/*!
+探索木のタスクへの分割
+
+探索木の大きさを推定してスレッド数から分割深さを決め、その深さまで展開した部分木をタスクとして列挙する。
+
+@param table		配置表
+@param board		ボード
+@param piece_num	ピースの数
+@param stride_num	ボードのstride
+@param thread_num	スレッド数
+@param tasks		タスク (出力, 逐次探索の順)
+@param call_num		分割深さまでの探索ノード数
+
+@return 分割深さ
+*/
+int split_parallel_tasks(
+	const PlacementTable& table,
+	vector<int>& board,
+	const int piece_num,
+	const int stride_num,
+	const int thread_num,
+	vector<ParallelTask>& tasks,
+	long long& call_num
+)
+{
+	vector<bool> used(piece_num, false);
+	TreeEstimate estimate;
+	estimate_tree(estimate, table, used, board, 0, piece_num, stride_num, PARALLEL_ESTIMATE_PROBES, PARALLEL_ESTIMATE_SEED);
+	const int split_depth = choose_split_depth(estimate, thread_num);
+
+	ParallelTask prefix;
+	split_tasks(table, used, board, 0, split_depth, piece_num, stride_num, prefix, tasks, call_num);
+	return split_depth;
+}
+
+/*!
+タスク(部分木)の探索
+
+部分木の根まで配置してから探索し、終了後に元に戻す。
+
+@param table		配置表
+@param task			タスク
+@param used			ペントミノが使用済かを表すフラグ配列 (全て未使用)
+@param node			探査ノード (ピース数+1, 終端はEND_OF_NODE)
+@param board		ボード (空)
+@param solution		解の受け取り先
+@param find_all		全ての解を見つけるか?
+@param stride_num	ボードのstride
+@param call_num		探索ノード数
+
+@retuen ture:探索を終了した (!find_all で解を見つけた、または solution.Done())
+*/
+bool search_parallel_task(
+	const PlacementTable& table,
+	const ParallelTask& task,
+	vector<bool>& used,
+	int* node,
+	vector<int>& board,
+	SolutionSink& solution,
+	const bool find_all,
+	const int stride_num,
+	long long& call_num
+)
+{
+	//部分木の根まで配置する
+	int* current_node = node;
+	for (auto& e : task){
+		const Placement* p = &table.placement[e.second];
+		for (int k = 0; k < PIECE_BLOCK_NUM; k++){ board[e.first + p->offsets[k]] = p->piece; }
+		used[p->piece] = true;
+		*current_node++ = p->piece;
+	}
+
+	bool done = false;
+	if (*current_node == END_OF_NODE){
+		solution.Push(board);
+		done = !find_all || solution.Done();
+	}
+	else{
+		int next = task.back().first;
+		while (board[next] != BOARD_CELL_EMPTY){ next++; }
+		done = find_solution_table(table, used, &board[0], next, current_node, board, solution, find_all, stride_num, call_num);
+	}
+
+	//修復 restore
+	for (auto& e : task){
+		const Placement* p = &table.placement[e.second];
+		for (int k = 0; k < PIECE_BLOCK_NUM; k++){ board[e.first + p->offsets[k]] = BOARD_CELL_EMPTY; }
+		used[p->piece] = false;
+	}
+	return done;
+}
+
+//-----------------------------------------------------------------------------
+// ReorderBuffer
+
+/*!
+@param _next		解の受け取り先 (タスクの番号順に渡す)
+@param _window		同時に実行するタスクの範囲 (スレッド数以上)
+@param _find_all	全ての解を見つけるか? (otherwise, 最初の解を含むタスクまで)
+*/
+ReorderBuffer::ReorderBuffer(SolutionSink& _next, const int _window, const bool _find_all)
+	: next(_next), window(max(_window, 1)), find_all(_find_all), head(0), stop_task(INT_MAX), slot(window), ready(window, false)
+{
+}
+
+/*!
+タスクの開始
+
+タスクが先頭から window 個の範囲に入るまで待つ。
+
+@return false:タスクは不要 (それより前のタスクで探索を終了した)
+*/
+bool ReorderBuffer::Acquire(const int task){
+	unique_lock<mutex> lock(mtx);
+	cv.wait(lock, [&]{ return task < head + window || task > stop_task; });
+	return task <= stop_task;
+}
+
+/*!
+タスクの解の受け取り
+
+先頭のタスクなら、溜めておいた解に続けて次の受け取り先へ渡す。それ以外は buffer に溜める。
+*/
+void ReorderBuffer::Push(const int task, const vector<int>& board, vector<vector<int>>& buffer){
+	lock_guard<mutex> lock(mtx);
+	if (task == head){
+		for (auto& b : buffer) next.Push(b);
+		buffer.clear();
+		next.Push(board);
+		if (!find_all || next.Done()) stop_task = min(stop_task, task);
+	}
+	else{
+		buffer.push_back(board);
+	}
+}
+
+/*!
+タスクの完了
+
+先頭から完了しているタスクの解を順に次の受け取り先へ渡し、先頭を進める。
+*/
+void ReorderBuffer::Complete(const int task, vector<vector<int>>& buffer){
+	lock_guard<mutex> lock(mtx);
+	const bool found = !buffer.empty();
+	slot[task % window].swap(buffer);
+	ready[task % window] = true;
+	if (!find_all && found) stop_task = min(stop_task, task);
+
+	while (head <= stop_task && ready[head % window]){
+		vector<vector<int>>& solution = slot[head % window];
+		for (auto& b : solution) next.Push(b);
+		solution.clear();
+		ready[head % window] = false;
+		if (next.Done()) stop_task = min(stop_task, head);
+		head++;
+	}
+	cv.notify_all();
+}
+
+//-----------------------------------------------------------------------------
+// public functions
+
+/*!
+ペントミノの解を見つける。(std::threadによる並列探索)
+
+@param rows 配置するボードの行数
+@param cols 配置するボードの列数
+@param find_all 全ての解を見つけるか?
+@param print_all 全ての解を表示するか?
+@param swap_ij 行と列を入れ替えて探索しているか?(表示時に戻す)
+@param thread_num スレッド数 (0:コア数)
+@param affinity スレッドをCPUに固定するか?
+@param archive_path 解を書き出すアーカイブファイル (NULL:書き出さない)
+
+@return 解の数 (-1:アーカイブの書き出しエラー)
+*/
+int solve_pentomino_thread(int rows, int cols, const bool find_all, const bool print_all, const bool swap_ij, int thread_num, const bool affinity, const char* archive_path){
+	assert(rows > 0);
+	assert(cols > 0);
+
+	if (thread_num <= 0) thread_num = (int)thread::hardware_concurrency();
+	if (thread_num <= 0) thread_num = 1;
+
+	vector<Piece> pieces;
+	{
+		PhaseTimer phase(PROFILE_INIT_PIECES);
+		init_pieces(pieces, rows, cols);
+	}
+	const int piece_num = (int)pieces.size();
+
+	//自明な条件の削除
+	if (piece_num*PIECE_BLOCK_NUM > (rows*cols)) return 0;
+
+	ArchiveWriter archive;
+	if (archive_path && !archive.Open(archive_path, pieces, rows, cols, swap_ij, true)) return -1;
+
+	SolutionList solution(print_all ? INT_MAX : 1, archive_path ? &archive : NULL, find_all ? INT_MAX : 1);
+	ReorderBuffer reorder(solution, thread_num * REORDER_WINDOW_PER_THREAD, find_all);
+	{
+		Timer tmr("process time:\t");
+
+		vector<int> board;
+		PlacementTable table;
+		vector<ParallelTask> tasks;
+		ParallelProgress progress;
+		long long call_num = 0;
+		{
+			PhaseTimer phase(PROFILE_BOARD_SETUP);
+			board = create_board(rows, cols);
+			build_placement_table(table, pieces, board);
+
+			//タスクの生成
+			const int split_depth = split_parallel_tasks(table, board, piece_num, cols + 1, thread_num, tasks, call_num);
+			printf("split_depth:%d\ttask_num:%d\n", split_depth, (int)tasks.size());
+
+			if (g_progress_interval > 0) estimate_tasks(table, tasks, board, piece_num, cols + 1, progress);
+		}
+
+		PhaseTimer phase(PROFILE_SEARCH);
+
+		atomic<int> next_task(0);
+		atomic<long long> total_call_num(call_num);
+		ParallelProgress* progress_ptr = g_progress_interval > 0 ? &progress : NULL;
+		progress.running = thread_num;
+		const auto start = chrono::steady_clock::now();
+
+		vector<thread> threads;
+		for (int id = 0; id < thread_num; id++){
+			threads.push_back(thread(parallel_worker, id, affinity, ref(table), ref(tasks), rows, cols, piece_num, find_all,
+				ref(next_task), ref(reorder), ref(total_call_num), progress_ptr));
+		}
+
+		if (progress_ptr){	//全てのワーカーが終了するまで、一定間隔で進捗を表示する
+			unique_lock<mutex> lock(progress.mtx);
+			while (!progress.cv.wait_for(lock, chrono::seconds(g_progress_interval), [&]{ return progress.running == 0; })){
+				const double sec = chrono::duration_cast<chrono::duration<double>>(chrono::steady_clock::now() - start).count();
+				print_progress(progress, (int)tasks.size(), sec);
+			}
+		}
+		for (auto& th : threads) th.join();
+
+		g_find_solution_call_num += total_call_num.load();
+	}
+
+	if (!archive.Close()) return -1;
+
+	{	//解の表示
+		PhaseTimer phase(PROFILE_OUTPUT);
+		SolutionWriter writer(pieces, rows, cols, swap_ij);
+		int i = 0;
+		for (auto itr = solution.solution.begin(); itr != solution.solution.end(); ++itr, i++) {
+			writer.Write(*itr, i + 1);
+		}
+	}
+
+	return find_all ? solution.num : min(solution.num, 1);
+}
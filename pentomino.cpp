@@ -48,45 +48,37 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <algorithm>
 #include <memory>
 #include <chrono>
+#include <atomic>
 #include <assert.h>
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 #include "getopt.h"
+#include "pentomino.h"
+#include "pentomino_internal.h"
 
 using namespace std;
 
-//-----------------------------------------------------------------------------
 /*!
-timer for process time measurement
+const & define macro
 */
-class Timer {
-private:
-	std::chrono::system_clock::time_point start;
-	std::chrono::system_clock::time_point end;
-	string msg;
-public:
-	Timer(string _msg) { msg = _msg;  Start(); }
-	~Timer(void) { Stop(); std::cout << msg << std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count() << "[ms]" << std::endl; }
-	void Start(void) { start = std::chrono::system_clock::now(); }
-	void Stop(void) { end = std::chrono::system_clock::now(); }
-
-};
-
+#define OMP_REORDER_WINDOW_PER_THREAD	16	//number of tasks in the reorder window per thread
 
 /*!
-const & define macro
+global var. (for debug)
 */
-#define END_OF_NODE -1					//end of node
-#define BOARD_CELL_EMPTY  -1			//cell is empty 
-#define BOARD_CELL_BOARDER  INT_MAX		//cell is boarder 
-#define PIECE_BLOCK_NUM 5				//piece block num (pentomino==5)
-
-#define PRINT_COLOR_PIECE				//print color
-
+long long g_find_solution_call_num = 0;	//!< total number of  calling function.
 
 /*!
-global var. (for debug)
+global var. (print option)
 */
-int g_find_solution_call_num = 0;	//!< total number of  calling function.
+#ifdef PRINT_COLOR_PIECE
+print_format_t g_print_format = PRINT_FORMAT_COLOR;
+#else
+print_format_t g_print_format = PRINT_FORMAT_PLAIN;
+#endif
 
 //-----------------------------------------------------------------------------
 
@@ -205,21 +197,6 @@ struct pentomino_database_t{
 };
 
 
-/*!
-pentomino piece struct
-*/
-typedef struct {
-	char	name;				//!< piece name
-	char	color[32];			//!< piece color
-	int    shape_num;			//!< shape num
-	struct {
-		//!< the offset address from shape origin(left top) for each block positions.
-		//!< note: the stride depends on board size.
-		int offsets[PIECE_BLOCK_NUM];
-	} shape[8];					//!< the shape data for rotate/flip pieces.
-} Piece;
-
-
 //-----------------------------------------------------------------------------
 // private functions
 
@@ -233,7 +210,7 @@ rows+1 , cols+1のサイズの密な一次元配列のボードを生成する
 @param cols : ボードの列数
 @retrun 初期化されたボード配列 int[(rows + 1)*(cols + 1)]
 */
-static vector<int> create_board(int rows, int cols){
+vector<int> create_board(int rows, int cols){
 	vector<int> board((rows + 1)*(cols + 1));
 	int* _board = &board[0];
 
@@ -251,53 +228,6 @@ static vector<int> create_board(int rows, int cols){
 	return board;
 }
 
-/*!
-ボードの表示
-*/
-static void print_board(const vector<Piece>& pieces, const vector<int> board, const int rows, const int cols, const bool swap_ij)
-{
-	if (swap_ij) {
-		for (int x = 0; x < cols; x++) {
-			for (int y = 0; y < rows; y++) {
-				int idx = y * (cols + 1) + x;
-				const int n = board[idx];
-				if (n != BOARD_CELL_EMPTY) {
-					printf("%s%c", pieces[n].color,pieces[n].name);
- 	
-				}
-				else {
-					printf("%c", ' ');
-				}
-			}
-			printf("\n");
-		}
-		printf("\n");
-	}
-	else {
-		for (int y = 0; y < rows; y++) {
-			for (int x = 0; x < cols; x++) {
-				int idx = y * (cols + 1) + x;
-				const int n = board[idx];
-				if (n != BOARD_CELL_EMPTY) {
-					printf("%s%c", pieces[n].color,pieces[n].name);
-				}
-				else {
-					printf("%c", ' ');
-				}
-			}
-			printf("\n");
-		}
-		printf("\n");
-	}
-
-#ifdef PRINT_COLOR_PIECE 
-	printf("%s", "\x1b[49m\x1b[39m");
-#endif
-
-}
-
-
-
 /*!
 冗長な形状の削除。
 remove redundant shape.
@@ -425,8 +355,9 @@ initialize piece data.
 @param pieces: pentomino piece data.
 @param rows: rows of the board to place the pentomino pieces.
 @param cols: columns of the board to place the pentomino pieces.
+@param remove_redundant: remove redundant shape (see remove_redundant_shape).
 */
-static void init_pieces(vector<Piece>& pieces, int rows, int cols){
+void init_pieces(vector<Piece>& pieces, int rows, int cols, const bool remove_redundant){
 
 	const int num = sizeof(database) / sizeof(database[0]);
 
@@ -436,9 +367,9 @@ static void init_pieces(vector<Piece>& pieces, int rows, int cols){
 		pentomino_database_t* db = &database[i];
 		pieces[i].name = db->name;
 #ifdef PRINT_COLOR_PIECE 
-		strncpy(pieces[i].color,db->color,sizeof(pieces[i].color));
+		snprintf(pieces[i].color, sizeof(pieces[i].color), "%s", db->color);
 #else
-		strncpy(pieces[i].color,"",sizeof(pieces[i].color));
+		pieces[i].color[0] = '\0';
 #endif
 		int j = 0;
 		char shape[sizeof(db->data)];
@@ -501,11 +432,45 @@ static void init_pieces(vector<Piece>& pieces, int rows, int cols){
 
 	}
 
-	remove_redundant_shape(pieces);
+	if (remove_redundant) remove_redundant_shape(pieces);
 	sort_pieces_by_shape_num(pieces);
 }
 
 
+/*!
+ペントミノのブロックの座標
+get the block positions of pieces. (for polycube puzzles, the pieces lie on the plane z=0)
+
+@param blocks: block positions of pentomino pieces (in database order).
+*/
+void init_piece_blocks(vector<PieceBlocks>& blocks){
+	const int num = sizeof(database) / sizeof(database[0]);
+
+	blocks.resize(num);
+
+	for (int i = 0; i < num; i++){
+		pentomino_database_t* db = &database[i];
+		blocks[i].name = db->name;
+#ifdef PRINT_COLOR_PIECE 
+		snprintf(blocks[i].color, sizeof(blocks[i].color), "%s", db->color);
+#else
+		blocks[i].color[0] = '\0';
+#endif
+		int k = 0;
+		for (int y = 0; y < db->rows; y++){
+			for (int x = 0; x < db->cols; x++){
+				if (!db->data[y*db->cols + x]) continue;
+				assert(k < PIECE_BLOCK_NUM);
+				blocks[i].block[k][0] = x;
+				blocks[i].block[k][1] = y;
+				blocks[i].block[k][2] = 0;
+				k++;
+			}
+		}
+	}
+}
+
+
 /*!
 現在のノード、現在のボード位置における解の探索
 
@@ -523,13 +488,13 @@ static void init_pieces(vector<Piece>& pieces, int rows, int cols){
 
 @retuen ture:解を見つけた
 */
-static bool find_solution(
+bool find_solution(
 	const vector<Piece>& pieces,
 	vector<bool>& used,
 	int* current_board,
 	int* current_node,
 	const vector<int>&board,
-	list<vector<int>>& solution,
+	SolutionSink& solution,
 	const bool find_all,
 	const int stride_num
 )
@@ -573,7 +538,7 @@ static bool find_solution(
 #ifdef _OPENMP
 #pragma omp critical			
 #endif
-				{	solution.push_back(board);	}		//解をリストにコピーする。複数のスレッドで発生するのでcriticalで囲む
+				{	solution.Push(board);	}		//解をリストにコピーする。複数のスレッドで発生するのでcriticalで囲む
 				
 				if (!find_all)	return true;			//　単一解であれば、即時return
 			}
@@ -613,10 +578,12 @@ static bool find_solution(
 @param cols 配置するボードの列数
 @param find_all 全ての解を見つけるか?
 @param print_all 全ての解を表示するか?
+@param swap_ij 行と列を入れ替えて探索しているか?(表示時に戻す)
+@param archive_path 解を書き出すアーカイブファイル (NULL:書き出さない)
 
-@return 解の数
+@return 解の数 (-1:アーカイブの書き出しエラー)
 */
-int solve_pentomino(int rows, int cols, const bool find_all, const bool print_all, const bool swap_ij){
+int solve_pentomino(int rows, int cols, const bool find_all, const bool print_all, const bool swap_ij, const char* archive_path){
 	assert(rows > 0);
 	assert(cols > 0);
 
@@ -626,7 +593,10 @@ int solve_pentomino(int rows, int cols, const bool find_all, const bool print_al
 	if (piece_num*PIECE_BLOCK_NUM > (rows*cols)) return 0;
 
 	vector<Piece> pieces;
-	init_pieces(pieces, rows, cols);
+	{
+		PhaseTimer phase(PROFILE_INIT_PIECES);
+		init_pieces(pieces, rows, cols);
+	}
 
 	vector<bool> used(piece_num, false);
 
@@ -634,27 +604,38 @@ int solve_pentomino(int rows, int cols, const bool find_all, const bool print_al
 	node[piece_num] = END_OF_NODE;			// nodeの終端を表す。
 	int* current_node = &(node[0]);
 
-	vector<int>  board = create_board(rows, cols);
+	vector<int>  board;
+	{
+		PhaseTimer phase(PROFILE_BOARD_SETUP);
+		board = create_board(rows, cols);
+	}
 	int* current_board = &(board[0]);
 
-	list<vector<int>> solution;
+	ArchiveWriter archive;
+	if (archive_path && !archive.Open(archive_path, pieces, rows, cols, swap_ij, true)) return -1;
+
+	SolutionList solution(print_all ? INT_MAX : 1, archive_path ? &archive : NULL);
 	{
 		Timer tmr("process time:\t");
+		PhaseTimer phase(PROFILE_SEARCH);
+		PerfCounter counter;
+		const long long call_num = g_find_solution_call_num;
+		counter.Start();
 		find_solution(pieces, used, current_board, current_node, board, solution, find_all,cols+1);
+		counter.Stop();
+		profile_add_thread(0, counter, g_find_solution_call_num - call_num);
 	}
 
-	int solution_num = (int)solution.size();
+	if (!archive.Close()) return -1;
+	int solution_num = solution.num;
 
 	{	//解の表示
+		PhaseTimer phase(PROFILE_OUTPUT);
+		SolutionWriter writer(pieces, rows, cols, swap_ij);
 		int i = 0;
 
-		for (auto itr = solution.begin(); itr != solution.end(); ++itr, i++) {
-			vector<int> board = *itr;
-
-			printf("#%d\n", i+1);
-			print_board(pieces, board, rows, cols, swap_ij);
-
-			if (!print_all) break;
+		for (auto itr = solution.solution.begin(); itr != solution.solution.end(); ++itr, i++) {
+			writer.Write(*itr, i + 1);
 		}
 	}
 
@@ -664,14 +645,19 @@ int solve_pentomino(int rows, int cols, const bool find_all, const bool print_al
 /*!
 ペントミノの解を見つける。(OpenMPによる並列探索)
 
+std::threadによる並列探索と同じく、探索木をタスク(部分木)に分割して探索し、
+解はタスクの順に並べ替えて、逐次探索と同じ順に出力する。
+
 @param rows 配置するボードの行数
 @param cols 配置するボードの列数
 @param find_all 全ての解を見つけるか?
 @param print_all 全ての解を表示するか?
+@param swap_ij 行と列を入れ替えて探索しているか?(表示時に戻す)
+@param archive_path 解を書き出すアーカイブファイル (NULL:書き出さない)
 
-@return 解の数
+@return 解の数 (-1:アーカイブの書き出しエラー)
 */
-int solve_pentomino_omp(int rows, int cols, const bool find_all, const bool print_all, const bool swap_ij){
+int solve_pentomino_omp(int rows, int cols, const bool find_all, const bool print_all, const bool swap_ij, const char* archive_path){
 	assert(rows > 0);
 	assert(cols > 0);
 
@@ -681,101 +667,96 @@ int solve_pentomino_omp(int rows, int cols, const bool find_all, const bool prin
 	if (piece_num*PIECE_BLOCK_NUM > (rows*cols)) return 0;
 
 	vector<Piece> pieces;
-	init_pieces(pieces, rows, cols);
+	{
+		PhaseTimer phase(PROFILE_INIT_PIECES);
+		init_pieces(pieces, rows, cols);
+	}
 
-	int exit_frag = 0;
 	const int stride_num = cols + 1;
+#ifdef _OPENMP
+	const int thread_num = omp_get_max_threads();
+#else
+	const int thread_num = 1;
+#endif
 
+	ArchiveWriter archive;
+	if (archive_path && !archive.Open(archive_path, pieces, rows, cols, swap_ij, true)) return -1;
 
-	list<vector<int>> solution;
+	SolutionList solution(print_all ? INT_MAX : 1, archive_path ? &archive : NULL);
 	{
 		Timer tmr("process time:\t");
 
-#ifdef _OPENMP
-#pragma omp parallel for schedule(dynamic)
-#endif
-		for (int i = 0; i < piece_num; i++){
+		//探索木をタスク(部分木)に分割する
+		vector<int> board;
+		PlacementTable table;
+		vector<ParallelTask> tasks;
+		long long call_num = 0;
+		{
+			PhaseTimer phase(PROFILE_BOARD_SETUP);
+			board = create_board(rows, cols);
+			build_placement_table(table, pieces, board);
+			split_parallel_tasks(table, board, piece_num, stride_num, thread_num, tasks, call_num);
+		}
+
+		PhaseTimer phase(PROFILE_SEARCH);
 
-			//他スレッドで解を見つけた場合 
-			if (exit_frag) continue;
+		//解はタスクの順(逐次探索と同じ順)に並べ替える
+		ReorderBuffer reorder(solution, thread_num * OMP_REORDER_WINDOW_PER_THREAD, find_all);
+		const int task_num = (int)tasks.size();
+		atomic<int> next_task(0);
 
+#ifdef _OPENMP
+#pragma omp parallel reduction(+:call_num)
+#endif
+		{
 			//thread local 
 			vector<bool> used(piece_num, false);
 
 			vector<int>  node(piece_num + 1, 0);	//
 			node[piece_num] = END_OF_NODE;			// nodeの終端を表す。
-			int* current_node = &(node[0]);
 
-			vector<int>  board = create_board(rows, cols);
-			int* current_board = &(board[0]);
+			vector<int>  local_board = create_board(rows, cols);
 
-			const Piece* piece = &pieces[i];
+			PerfCounter counter;
+			counter.Start();
 
-			//全ての配置で探索
-			for (int j = 0; j < piece->shape_num; j++){
-				if (exit_frag) continue;
-				const int* offset = &(piece->shape[j].offsets[0]);
-
-				//ピースが置けるかチェックする。
-				bool can_place = true;
-				for (int k = 0; k<PIECE_BLOCK_NUM; k++){
-					if (current_board[offset[k]] != BOARD_CELL_EMPTY) { can_place = false;  break; }
-				}
-				if (!can_place)	continue;
+			//タスクの番号順に取り出す (parallel_worker と同じ)
+			//番号は共有のカウンタで配るので、ReorderBuffer::Acquire の待ちは、OpenMPの実装に依らず先のタスクの完了で解ける
+			for (;;){
+				const int t = next_task.fetch_add(1);
+				if (t >= task_num) break;
+				if (!reorder.Acquire(t)) break;		//他スレッドで解を見つけた場合
 
-				{	//更新　（ここでの操作は、下の修復と対になる)
-					for (int k = 0; k<PIECE_BLOCK_NUM; k++){ current_board[offset[k]] = i; }	// ピースを置く
-					used[i] = true;				//使用済みフラグの更新
-					*current_node++ = i;		//current_nodeの更新
-				}
+				TaskSink task_solution(reorder, t);
+				search_parallel_task(table, tasks[t], used, &node[0], local_board, task_solution, find_all, stride_num, call_num);
+			}
 
-				{
-					int* current_board_save = current_board;						//current_boardの更新の前に保存しておく
-					while (*current_board != BOARD_CELL_EMPTY){ current_board++; }	//current_boardの更新
-#if 1
-					//全てのピース、配置で共通な除外条件をチェック
-					//もっと積極的な枝狩でも良いが、条件チェックが重いと枝狩の恩恵が薄くなる。
-					if (current_board[1] == BOARD_CELL_EMPTY || current_board[stride_num] == BOARD_CELL_EMPTY)
-#endif
-					{	//再帰
-						if (find_solution(pieces, used, current_board, current_node, board, solution, find_all, stride_num)){
-							if (!find_all)	{
+			//call_num はスレッド毎のreduction変数 (このスレッドの探索ノード数)
+			counter.Stop();
 #ifdef _OPENMP
-#pragma omp atomic
+			profile_add_thread(omp_get_thread_num(), counter, call_num);
+#else
+			profile_add_thread(0, counter, call_num);
 #endif
-								exit_frag++;
-								if (exit_frag) continue;
-							}
-						}
-					}
-					current_board = current_board_save;		//保存しておいたcurrent_boardで修復する
-				}
-
-				{	//修復　restore
-					for (int k = 0; k<PIECE_BLOCK_NUM; k++){ current_board[offset[k]] = BOARD_CELL_EMPTY; }	// ピースを戻す
-					used[i] = false;
-					current_node--;
-				}
-			}
 		}
+
+		g_find_solution_call_num += call_num;
 	}
 
-	int solution_num = (int)solution.size();
+	if (!archive.Close()) return -1;
+	int solution_num = solution.num;
 
 	{	//解の表示
+		PhaseTimer phase(PROFILE_OUTPUT);
+		SolutionWriter writer(pieces, rows, cols, swap_ij);
 		int i = 0;
 
-		for (auto itr = solution.begin(); itr != solution.end(); ++itr, i++) {
-			vector<int> board = *itr;
-
-			printf("#%d\n", i + 1);
-			print_board(pieces, board, rows, cols, swap_ij);
-
-			if (!print_all) break;
+		for (auto itr = solution.solution.begin(); itr != solution.solution.end(); ++itr, i++) {
+			writer.Write(*itr, i + 1);
 		}
 	}
 
-	return solution_num;
+	return find_all ? solution_num : min(solution_num, 1);
 }
 
 
@@ -788,9 +769,36 @@ void usage(void) {
 	"usage:	pentomino [-r rows] [-c cols ] [-fpm]""\n"
 	"-r rows of the board to place the pentomino pieces.""\n"
 	"-c cols of the board to place the pentomino pieces.""\n"
+	"-W areas count solutions of all boards of the areas.(A[,A...] rectangles of area A with A-60 holes at any cells)""\n"
+	"-z layers find solutions of the box rows x cols x layers packed with pentacubes.(default: the 12 flat pentominoes)""\n"
+	"-K pieces pentacubes of the box.(flat FILNPTUVWXYZ, solid ABCDEGHJKMQ, mirror images of chiral ones ghjkmq)""\n"
+	"-M pieces may be reflected in the box.(48 orientations, a chiral piece and its mirror image are the same piece)""\n"
 	"-f find all solutions.""\n"
 	"-p print all solutions.(otherwise, print only first founded solution.)""\n"
-	"-m find solutions usinhg openmp.""\n"
+	"-m find solutions usinhg openmp.(without openmp, same as -j 0)""\n"
+	"-j threads find solutions using std::thread.(0: number of cores)""\n"
+	"-A pin threads to cores.""\n"
+	"-t print the time of each phase and the nodes of each thread.""\n"
+	"-H also count hardware events of each thread.(linux perf_event, implies -t)""\n"
+	"-P workers find first solution by portfolio search.(0: number of cores)""\n"
+	"-B seeds benchmark portfolio search time-to-first-solution over seeds.""\n"
+	"-s seed random seed.""\n"
+	"-N num find the first num solutions by the lazy iterator.""\n"
+	"-D num sample num random solutions uniformly.(with -s seed)""\n"
+	"-E probes estimate the size of the search tree by random probes.""\n"
+	"-R sec report progress to stderr every sec seconds.(without -j, same as -j 1)""\n"
+	"-o format print format of solutions.(plain, color, compact)""\n"
+	"-w file write all solutions to the binary archive file.""\n"
+	"-a file read solutions from the binary archive file.""\n"
+	"-C constraints find solutions matching the constraints.([!]X:r:c[,...] piece X covers (!:does not cover) row r col c)""\n"
+	"-X compare the constraint search with filtering all solutions.(with -W, compare the sweep with searching each board alone)""\n"
+	"-I inventory tile the board with pieces chosen from the inventory.(n: n copies of each piece, Xn: n copies of piece X, e.g. 1 or 2,X0)""\n"
+	"-S serve completion requests from stdin.""\n"
+	"-U path serve completion requests on the unix domain socket.""\n"
+	"-n no print the solution of the number in the archive.""\n"
+	"-T file test all engines against the known solutions and the search speed against the baseline file.""\n"
+	"-L record the search speed to the baseline file of -T.(instead of comparing with it)""\n"
+	"-F filter print solutions in the archive matching the filter.(X:r:c[,X:r:c...] or compact solution)""\n"
 	);
 }
 
@@ -802,8 +810,31 @@ int main(int argc, char* argv[]){
 	bool find_all = true;
 	bool print_all = false;
 	bool use_openmp = false;
-
-	while ((opt = getopt(argc, argv, "r:c:fpmh?")) != -1) {
+	int thread_num = -1;		//-1: not use std::thread
+	bool affinity = false;
+	int portfolio_num = -1;		//-1: not use portfolio
+	int bench_seed_num = 0;
+	unsigned int seed = 1;
+	int estimate_probe_num = 0;
+	int iterate_num = 0;
+	int sample_num = 0;
+	int layers = 0;			//0: plane board
+	const char* cube_pieces = NULL;		//NULL: 12 flat pentominoes
+	bool mirror = false;
+	const char* sweep = NULL;
+	const char* archive_write = NULL;
+	const char* archive_read = NULL;
+	const char* archive_filter = NULL;
+	int archive_no = 0;
+	const char* constraint = NULL;
+	const char* inventory = NULL;
+	bool constraint_compare = false;
+	bool serve = false;
+	const char* socket_path = NULL;
+	const char* test_baseline = NULL;
+	bool test_record = false;
+
+	while ((opt = getopt(argc, argv, "r:c:z:K:MW:fpmj:AtHP:B:s:E:R:N:D:o:w:a:n:F:C:XI:SU:T:Lh?")) != -1) {
 		switch (opt) {
 		case 'r':
 			rows = atoi(optarg);
@@ -811,6 +842,18 @@ int main(int argc, char* argv[]){
 		case 'c':
 			cols = atoi(optarg);
 			break;
+		case 'z':
+			layers = atoi(optarg);
+			break;
+		case 'K':
+			cube_pieces = optarg;
+			break;
+		case 'M':
+			mirror = true;
+			break;
+		case 'W':
+			sweep = optarg;
+			break;
 		case 'f':
 			find_all = true;
 			break;
@@ -820,6 +863,80 @@ int main(int argc, char* argv[]){
 		case 'm':
 			use_openmp = true;
 			break;
+		case 'j':
+			thread_num = atoi(optarg);
+			break;
+		case 'A':
+			affinity = true;
+			break;
+		case 't':
+			g_profile = true;
+			break;
+		case 'H':
+			g_profile = true;
+			g_profile_hw = true;
+			break;
+		case 'P':
+			portfolio_num = atoi(optarg);
+			break;
+		case 'B':
+			bench_seed_num = atoi(optarg);
+			break;
+		case 's':
+			seed = (unsigned int)strtoul(optarg, NULL, 0);
+			break;
+		case 'N':
+			iterate_num = atoi(optarg);
+			break;
+		case 'D':
+			sample_num = atoi(optarg);
+			break;
+		case 'E':
+			estimate_probe_num = atoi(optarg);
+			break;
+		case 'R':
+			g_progress_interval = atoi(optarg);
+			break;
+		case 'o':
+			if (!strcmp(optarg, "plain")) g_print_format = PRINT_FORMAT_PLAIN;
+			else if (!strcmp(optarg, "color")) g_print_format = PRINT_FORMAT_COLOR;
+			else if (!strcmp(optarg, "compact")) g_print_format = PRINT_FORMAT_COMPACT;
+			else { usage(); exit(EXIT_FAILURE); }
+			break;
+		case 'w':
+			archive_write = optarg;
+			break;
+		case 'a':
+			archive_read = optarg;
+			break;
+		case 'n':
+			archive_no = atoi(optarg);
+			break;
+		case 'F':
+			archive_filter = optarg;
+			break;
+		case 'C':
+			constraint = optarg;
+			break;
+		case 'X':
+			constraint_compare = true;
+			break;
+		case 'I':
+			inventory = optarg;
+			break;
+		case 'S':
+			serve = true;
+			break;
+		case 'U':
+			serve = true;
+			socket_path = optarg;
+			break;
+		case 'T':
+			test_baseline = optarg;
+			break;
+		case 'L':
+			test_record = true;
+			break;
 		case '?':
 		case 'h':
 		default: /* '?' */
@@ -829,6 +946,30 @@ int main(int argc, char* argv[]){
 	}
 
 
+	//アーカイブを書き出せるのは、逐次探索・OpenMP・std::threadによる探索のみ
+	if (archive_write && (sweep || layers > 0 || constraint || inventory || sample_num > 0 || iterate_num > 0
+		|| portfolio_num >= 0 || bench_seed_num > 0 || estimate_probe_num > 0 || serve || test_baseline)) {
+		printf("-w is supported only by the sequential, openmp (-m) and std::thread (-j) solvers.\n");
+		exit(EXIT_FAILURE);
+	}
+
+	if (serve){
+		return serve_pentomino(socket_path, thread_num < 0 ? 0 : thread_num) == 0 ? 0 : EXIT_FAILURE;
+	}
+
+	if (test_baseline){
+		Timer tmr("total time:\t");
+		return test_pentomino(test_baseline, test_record) == 0 ? 0 : EXIT_FAILURE;
+	}
+
+	if (archive_read){
+		Timer tmr("total time:\t");
+		int match_num = read_pentomino_archive(archive_read, archive_no, archive_filter, print_all);
+		if (match_num < 0) exit(EXIT_FAILURE);
+		printf("match_num: %d\n", match_num);
+		return 0;
+	}
+
 	{
 		Timer tmr("total time:\t");
 
@@ -840,9 +981,18 @@ int main(int argc, char* argv[]){
 
 		//print args..
 		printf("board rows:%d\tcols:%d\n", rows, cols);
+		if (layers > 0) printf("layers:%d\n", layers);
 		printf("find_all:%d\n", find_all);
 		printf("print_all:%d\n", print_all);
 		printf("use_openmp:%d\n", use_openmp);
+#ifndef _OPENMP
+		//OpenMPが無効の場合は、std::threadで並列に探索する
+		if (use_openmp && thread_num < 0) thread_num = 0;
+#endif
+		//進捗の表示は、std::threadによる探索で行う
+		if (g_progress_interval > 0 && thread_num < 0 && !use_openmp) thread_num = 1;
+		if (thread_num >= 0) printf("thread_num:%d\n", thread_num);
+		if (portfolio_num >= 0) printf("portfolio:%d\n", portfolio_num);
 
 		//clear globla val..
 		g_find_solution_call_num = 0;
@@ -854,18 +1004,63 @@ int main(int argc, char* argv[]){
 			swap_ij = true;
 		}
 
+		if (bench_seed_num > 0){
+			bench_pentomino_portfolio(rows, cols, swap_ij, portfolio_num, bench_seed_num);
+			return 0;
+		}
+
+		if (estimate_probe_num > 0){
+			estimate_pentomino(rows, cols, swap_ij, estimate_probe_num, seed);
+			return 0;
+		}
+
 		int solution_num;		//total solution num
 
-		if (use_openmp){
-			solution_num = solve_pentomino_omp(rows, cols, find_all, print_all, swap_ij);
+		if (sweep){
+			solution_num = sweep_pentomino(sweep, thread_num < 0 ? 0 : thread_num, constraint_compare);
+			if (solution_num < 0) {
+				printf("invalid areas: %s\n", sweep);
+				exit(EXIT_FAILURE);
+			}
+		}
+		else if (layers > 0){
+			solution_num = solve_pentacube(rows, cols, layers, cube_pieces, mirror, find_all, print_all, (use_openmp && thread_num < 0) ? 0 : thread_num);
+			if (solution_num < 0) exit(EXIT_FAILURE);
+		}
+		else if (constraint){
+			solution_num = solve_pentomino_constrained(rows, cols, find_all, print_all, swap_ij, constraint, constraint_compare);
+			if (solution_num < 0) exit(EXIT_FAILURE);
+		}
+		else if (inventory){
+			solution_num = solve_pentomino_subset(rows, cols, find_all, print_all, swap_ij, inventory);
+			if (solution_num < 0) exit(EXIT_FAILURE);
+		}
+		else if (sample_num > 0){
+			solution_num = sample_pentomino(rows, cols, print_all, swap_ij, sample_num, seed);
+		}
+		else if (iterate_num > 0){
+			solution_num = solve_pentomino_iterator(rows, cols, print_all, swap_ij, iterate_num);
+		}
+		else if (portfolio_num >= 0){
+			solution_num = solve_pentomino_portfolio(rows, cols, swap_ij, portfolio_num, seed);
+		}
+		else if (thread_num >= 0){
+			solution_num = solve_pentomino_thread(rows, cols, find_all, print_all, swap_ij, thread_num, affinity, archive_write);
+			if (solution_num < 0) exit(EXIT_FAILURE);
+		}
+		else if (use_openmp){
+			solution_num = solve_pentomino_omp(rows, cols, find_all, print_all, swap_ij, archive_write);
+			if (solution_num < 0) exit(EXIT_FAILURE);
 		}
 		else{
-			solution_num = solve_pentomino(rows, cols, find_all, print_all, swap_ij);
+			solution_num = solve_pentomino(rows, cols, find_all, print_all, swap_ij, archive_write);
+			if (solution_num < 0) exit(EXIT_FAILURE);
 		}
 
 
 		printf("solution_num: %d\n", solution_num);
-		printf("find_solution_call_num : %d\n", g_find_solution_call_num);
+		printf("find_solution_call_num : %lld\n", g_find_solution_call_num);
+		print_profile_report();
 	}
 
 //	printf("Hit return key.\n");
@@ -38,10 +38,12 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 @param cols 配置するボードの列数
 @param find_all 全ての解を見つけるか?
 @param print_all 全ての解を表示するか?
+@param swap_ij 行と列を入れ替えて探索しているか?(表示時に戻す)
+@param archive_path 解を書き出すアーカイブファイル (NULL:書き出さない)
 
-@return 解の数
+@return 解の数 (-1:アーカイブの書き出しエラー)
 */
-int solve_pentomino(int rows, int cols, const bool find_all, const bool print_all);
+int solve_pentomino(int rows, int cols, const bool find_all, const bool print_all, const bool swap_ij, const char* archive_path = NULL);
 
 /*!
 ペントミノの解を見つける。(OpenMPによる並列探索)
@@ -50,10 +52,253 @@ int solve_pentomino(int rows, int cols, const bool find_all, const bool print_al
 @param cols 配置するボードの列数
 @param find_all 全ての解を見つけるか?
 @param print_all 全ての解を表示するか?
+@param swap_ij 行と列を入れ替えて探索しているか?(表示時に戻す)
+@param archive_path 解を書き出すアーカイブファイル (NULL:書き出さない)
+
+@return 解の数 (-1:アーカイブの書き出しエラー)
+*/
+int solve_pentomino_omp(int rows, int cols, const bool find_all, const bool print_all, const bool swap_ij, const char* archive_path = NULL);
+
+/*!
+ペントミノの解を見つける。(std::threadによる並列探索)
+
+探索木を部分木(タスク)に分割し、各スレッドがタスクを順に取り出して探索する。
+OpenMPを有効にしなくても並列に探索する。
+
+@param rows 配置するボードの行数
+@param cols 配置するボードの列数
+@param find_all 全ての解を見つけるか?
+@param print_all 全ての解を表示するか?
+@param swap_ij 行と列を入れ替えて探索しているか?(表示時に戻す)
+@param thread_num スレッド数 (0:コア数)
+@param affinity スレッドをCPUに固定するか?
+@param archive_path 解を書き出すアーカイブファイル (NULL:書き出さない)
+
+@return 解の数 (-1:アーカイブの書き出しエラー)
+*/
+int solve_pentomino_thread(int rows, int cols, const bool find_all, const bool print_all, const bool swap_ij, int thread_num, const bool affinity, const char* archive_path = NULL);
+
+/*!
+ペントミノの解を一つ見つける。(ポートフォリオ探索)
+
+ピース順・探索方向・対称性除去に使う形状の異なる複数の探索をスレッドで並走させ、
+最初に解を見つけた探索の結果を採用する。他の探索はその時点で打ち切る。
+
+@param rows 配置するボードの行数
+@param cols 配置するボードの列数
+@param swap_ij 行と列を入れ替えて探索しているか?(表示時に戻す)
+@param worker_num 並走させる探索の数 (0:コア数)
+@param seed 乱数の種
+
+@return 解の数 (0 or 1)
+*/
+int solve_pentomino_portfolio(int rows, int cols, const bool swap_ij, int worker_num, unsigned int seed);
+
+/*!
+ポートフォリオ探索のベンチマーク
+
+seed を変えてポートフォリオ探索を繰り返し、最初の解を見つけるまでの時間の分布を
+逐次探索(solve_pentomino と同じ探索順)と比較して表示する。
+
+@param rows 配置するボードの行数
+@param cols 配置するボードの列数
+@param swap_ij 行と列を入れ替えて探索しているか?
+@param worker_num 並走させる探索の数 (0:コア数)
+@param seed_num 試行する seed の数
+*/
+void bench_pentomino_portfolio(int rows, int cols, const bool swap_ij, int worker_num, int seed_num);
+
+/*!
+配置条件付きでペントミノの解を見つける。
+
+条件を探索前に反映(ピースの事前配置、配置表からの除外)して探索木を枝狩りする。
+条件によって盤面の対称性が崩れるので、回転・鏡像による解も別の解として数える。
+
+@param rows 配置するボードの行数
+@param cols 配置するボードの列数
+@param find_all 全ての解を見つけるか?
+@param print_all 全ての解を表示するか?
+@param swap_ij 行と列を入れ替えて探索しているか?(表示時に戻す)
+@param spec 配置条件 "[!]X:r:c[,...]" r行c列をピースXで覆う(!:覆わない)
+@param compare 全ての解を探索してから条件で絞り込む場合と、探索ノード数を比較するか?
+
+@return 解の数 (-1:条件の書式エラー)
+*/
+int solve_pentomino_constrained(int rows, int cols, const bool find_all, const bool print_all, const bool swap_ij, const char* spec, const bool compare);
+
+/*!
+補完サーバ
+
+標準入力またはUnixドメインソケットから、部分的に埋まった盤面の補完要求を受けて解を返す。
+ピースデータと配置表はボードサイズ毎に生成して使い回す。(要求の書式は server.cpp を参照)
+
+@param socket_path Unixドメインソケットのパス (NULL:標準入力から要求を受ける)
+@param thread_num 標準入力の要求を処理するスレッド数 (0:コア数)
+
+@return 0:正常終了
+*/
+int serve_pentomino(const char* socket_path, int thread_num);
+
+/*!
+解のアーカイブの読み出し
+
+アーカイブファイルをメモリマップし、解の数を数える。
+指定された番号の解、またはフィルタに一致する解を表示する。
+
+@param path アーカイブファイル
+@param no 表示する解の番号 (1 origin, 0:指定なし)
+@param filter 解のフィルタ "X:r:c[,X:r:c...]" ピースXがr行c列を覆う解 (NULL:指定なし)
+@param print_all 一致する全ての解を表示するか?(otherwise, 最初の解のみ)
+
+@return 一致する解の数 (-1:読み出しエラー)
+*/
+int read_pentomino_archive(const char* path, int no, const char* filter, const bool print_all);
+
+/*!
+ペントミノの探索木の大きさを推定する。
+
+探索木の根から葉までのランダムな降下を繰り返し(Knuthの推定法)、
+全探索の前に探索ノード数・解の数・処理時間を予測する。
+
+@param rows 配置するボードの行数
+@param cols 配置するボードの列数
+@param swap_ij 行と列を入れ替えて探索しているか?
+@param probe_num 試行の回数
+@param seed 乱数のseed
+
+@return 探索ノード数の推定値
+*/
+double estimate_pentomino(int rows, int cols, const bool swap_ij, const int probe_num, const unsigned int seed);
+
+/*!
+ペントミノの解の列挙 (必要な分だけ取り出すイテレータ)
+
+探索の状態(ボード、探索スタック)を保持し、Nextを呼ぶ度に次の解まで探索を進める。
+探索するのは取り出した解までの部分木だけで、解の順は solve_pentomino と同じ。
+Print, Str は Next が true を返した後の現在の解を対象とし、Next が false を返した後は何も表示しない。(Strは空文字列)
+
+@code
+PentominoIterator itr(rows, cols, swap_ij);
+while (itr.Num() < 100 && itr.Next()) itr.Print();
+@endcode
+*/
+class PentominoIterator {
+public:
+	PentominoIterator(int rows, int cols, const bool swap_ij);
+	~PentominoIterator(void);
+	PentominoIterator(const PentominoIterator&) = delete;
+	PentominoIterator& operator=(const PentominoIterator&) = delete;
+
+	bool Next(void);
+	void Print(void);
+	const char* Str(void);
+	int Num(void) const;
+	long long CallNum(void) const;
+
+private:
+	struct State;
+	State* state;
+};
+
+/*!
+ペントミノの解を必要な数だけ見つける。(PentominoIteratorによる探索)
+
+@param rows 配置するボードの行数
+@param cols 配置するボードの列数
+@param print_all 全ての解を表示するか?
+@param swap_ij 行と列を入れ替えて探索しているか?(表示時に戻す)
+@param num 取り出す解の数
 
 @return 解の数
 */
-int solve_pentomino_omp(int rows, int cols, const bool find_all, const bool print_all);
+int solve_pentomino_iterator(int rows, int cols, const bool print_all, const bool swap_ij, const int num);
+
+/*!
+ペントミノの解をランダムにサンプリングする。
+
+全ての解を列挙せずに、部分木の解の数の推定値で重み付けした根から葉への降下で解を選び、
+棄却法で一様分布に近づける。
+
+@param rows 配置するボードの行数
+@param cols 配置するボードの列数
+@param print_all 全ての解を表示するか?(otherwise, 最初の解のみ)
+@param swap_ij 行と列を入れ替えて探索しているか?(表示時に戻す)
+@param num サンプリングする解の数
+@param seed 乱数のseed
+
+@return サンプリングした解の数
+*/
+int sample_pentomino(int rows, int cols, const bool print_all, const bool swap_ij, const int num, const unsigned int seed);
+
+/*!
+在庫からピースを選んでボードを埋める。
+
+全てのピースを1個ずつ使う代わりに、ピース毎に使える数(0個、1個、複数個)を指定し、
+ボードの面積/5 個のピースでボードをちょうど埋める。使うピースの組は探索の中で選び、
+ピース毎の残りの数と、空き領域の大きさ(5の倍数)で枝狩りする。
+使うピースの組によって盤面の対称性による冗長な形状の削除はできないので、回転・鏡像による解も別の解として数える。
+
+@param rows 配置するボードの行数
+@param cols 配置するボードの列数
+@param find_all 全ての解を見つけるか?
+@param print_all 全ての解を表示するか?
+@param swap_ij 行と列を入れ替えて探索しているか?(表示時に戻す)
+@param spec 在庫 "n|Xn[,...]" n:全てのピースをn個まで、Xn:ピースXをn個まで使える
+
+@return 解の数 (-1:在庫の書式エラー)
+*/
+int solve_pentomino_subset(int rows, int cols, const bool find_all, const bool print_all, const bool swap_ij, const char* spec);
+
+/*!
+ボードの族の解を一括して数える。
+
+面積毎に、行数 x 列数 = 面積 の全ての長方形と、(面積 - 60) 個の穴を任意のセルに開けたボードの解を数える。
+列数の等しいボードは、最も背の高いボードの探索(穴にする手を含む)と配置表を共有し、
+列数毎の探索は、探索ノード数の推定値の大きい順にスレッドに割り当てる。
+
+@param areas 面積の一覧 "A[,A...]" (60 <= A <= 60 + 16)
+@param thread_num スレッド数 (0:コア数)
+@param compare 比較の為、ボードを一つずつ探索した場合の時間も計測するか?
+
+@return 解の数の合計 (回転・鏡像による解を除く, -1:書式エラー)
+*/
+int sweep_pentomino(const char* areas, int thread_num, const bool compare = false);
+
+/*!
+立体のペントミノパズルの解を見つける。(ペンタキューブで直方体を埋める)
+
+ピースは、平面のペントミノ(厚さ1のペンタキューブ) FILNPTUVWXYZ と、平面にないペンタキューブ
+ABCDE GHJKMQ (chiralなピース GHJKMQ の鏡像は小文字の ghjkmq) から選ぶ。(既定は平面のペントミノ12個)
+直方体のセルの占有状態を128bitで表し、平面と同じく最初の空きセルを覆う配置を探索する。
+直方体の対称変換で重なる解は一つとして数える。(直方体をちょうど埋める場合)
+ピースの組が鏡像で閉じていなければ(鏡像を使わずにchiralなピースを選んだ場合)、対称変換は回転だけ。
+
+@param rows 直方体の辺の長さ
+@param cols 直方体の辺の長さ
+@param layers 直方体の辺の長さ
+@param pieces ピースの名前の列 (NULL:平面のペントミノ12個)
+@param mirror ピースの鏡像を使うか? (回転・鏡像の48通りの向き)
+@param find_all 全ての解を見つけるか?
+@param print_all 全ての解を表示するか?
+@param thread_num スレッド数 (0:コア数, -1:並列に探索しない)
+
+@return 解の数 (セルの数が128を超える場合は0, -1:ピースの名前の誤り)
+*/
+int solve_pentacube(int rows, int cols, int layers, const char* pieces, const bool mirror, const bool find_all, const bool print_all, int thread_num);
+
+/*!
+全ての探索エンジンの差分テストと性能ゲート。
+
+既知の解の数のボード(6x10, 5x12, 4x15, 3x20)で、各エンジン・スレッド数の解の数を確かめ、
+解のfingerprint列(アーカイブの索引と同じ FNV-1a hash)を逐次探索と比べる。
+逐次探索の探索速度(nodes/sec)が基準値から一定の割合以上下がった場合、基準値のファイルがない場合も失敗とする。
+
+@param baseline_path 探索速度の基準値のファイル
+@param record 計測値を基準値のファイルに書き出すか?(otherwise, 基準値と比べる)
+
+@return 失敗したテストの数
+*/
+int test_pentomino(const char* baseline_path, const bool record);
 
 #endif	/* _PENTOMINO_H_ */
 
@@ -0,0 +1,529 @@
+﻿/*
+Copyright (c) 2016, oasi-adamay
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+* Neither the name of glsCV nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*!
+@file	pentomino_internal.h
+@author	oasi-adamay
+@brief	ソルバ内部で共有するデータ型・関数の宣言。(pentomino.cpp 以外の探索モジュール用)
+*/
+
+#ifndef _PENTOMINO_INTERNAL_H_
+#define _PENTOMINO_INTERNAL_H_
+
+#include <stdio.h>
+#include <string>
+#include <climits>
+#include <vector>
+#include <list>
+#include <iostream>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+
+//-----------------------------------------------------------------------------
+/*!
+timer for process time measurement
+*/
+class Timer {
+private:
+	std::chrono::system_clock::time_point start;
+	std::chrono::system_clock::time_point end;
+	std::string msg;
+public:
+	Timer(std::string _msg) { msg = _msg;  Start(); }
+	~Timer(void) { Stop(); std::cout << msg << std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count() << "[ms]" << std::endl; }
+	void Start(void) { start = std::chrono::system_clock::now(); }
+	void Stop(void) { end = std::chrono::system_clock::now(); }
+
+};
+
+
+/*!
+const & define macro
+*/
+#define END_OF_NODE -1					//end of node
+#define BOARD_CELL_EMPTY  -1			//cell is empty
+#define BOARD_CELL_BOARDER  INT_MAX		//cell is boarder
+#define PIECE_BLOCK_NUM 5				//piece block num (pentomino==5)
+
+#define PRINT_COLOR_PIECE				//print color
+
+
+/*!
+global var. (for debug)
+*/
+extern long long g_find_solution_call_num;	//!< total number of  calling function.
+
+
+/*!
+print format of solutions
+*/
+enum print_format_t {
+	PRINT_FORMAT_PLAIN,			//!< piece name only
+	PRINT_FORMAT_COLOR,			//!< piece name with color code
+	PRINT_FORMAT_COMPACT,		//!< one line per solution (rows are separated by '/')
+};
+
+extern print_format_t g_print_format;	//!< print format (set by command line option)
+
+
+/*!
+pentomino piece struct
+*/
+typedef struct {
+	char	name;				//!< piece name
+	char	color[32];			//!< piece color
+	int    shape_num;			//!< shape num
+	struct {
+		//!< the offset address from shape origin(left top) for each block positions.
+		//!< note: the stride depends on board size.
+		int offsets[PIECE_BLOCK_NUM];
+	} shape[8];					//!< the shape data for rotate/flip pieces.
+} Piece;
+
+/*!
+pentomino piece block positions (for polycube puzzles)
+*/
+typedef struct {
+	char	name;						//!< piece name
+	char	color[32];					//!< piece color
+	int		block[PIECE_BLOCK_NUM][3];	//!< block positions (x, y, z)
+} PieceBlocks;
+
+
+/*!
+解の受け取り先
+
+探索で見つけた解(ボード)を受け取る。
+並列探索ではcritical section内で呼ばれる。
+Doneがtrueを返すと、配置表による探索(find_solution_table)はその時点で終了する。
+*/
+class SolutionSink {
+public:
+	virtual ~SolutionSink(void) {}
+	virtual void Push(const std::vector<int>& board) = 0;
+	virtual bool Done(void) const { return false; }
+};
+
+/*!
+解のリスト
+
+解の数を数え、表示する解(先頭からkeep_num個)だけをリストに残す。
+nextが指定されていれば、全ての解をnextにも渡す。
+limit個の解を見つけたら探索を終了する。
+*/
+class SolutionList : public SolutionSink {
+public:
+	std::list<std::vector<int>> solution;	//!< 表示する解
+	int num;								//!< 解の数
+	int keep_num;							//!< リストに残す解の数
+	SolutionSink* next;						//!< 解の転送先 (NULL:なし)
+	int limit;								//!< 探索する解の数
+
+	SolutionList(int _keep_num = INT_MAX, SolutionSink* _next = NULL, int _limit = INT_MAX) : num(0), keep_num(_keep_num), next(_next), limit(_limit) {}
+	void Push(const std::vector<int>& board) {
+		num++;
+		if ((int)solution.size() < keep_num) solution.push_back(board);
+		if (next) next->Push(board);
+	}
+	bool Done(void) const { return num >= limit; }
+};
+
+
+//-----------------------------------------------------------------------------
+// shared functions (pentomino.cpp)
+
+std::vector<int> create_board(int rows, int cols);
+
+void init_pieces(std::vector<Piece>& pieces, int rows, int cols, const bool remove_redundant = true);
+
+void init_piece_blocks(std::vector<PieceBlocks>& blocks);
+
+bool find_solution(
+	const std::vector<Piece>& pieces,
+	std::vector<bool>& used,
+	int* current_board,
+	int* current_node,
+	const std::vector<int>&board,
+	SolutionSink& solution,
+	const bool find_all,
+	const int stride_num
+);
+
+
+//-----------------------------------------------------------------------------
+// placement table (placement.cpp)
+
+/*!
+ピースの配置 (ボード上の位置に置ける、ピース・形状の組)
+*/
+struct Placement {
+	int		piece;						//!< piece index
+	int		shape;						//!< shape index
+	int		skip;						//!< number of placements of the same piece from this (to skip the used piece)
+	int		offsets[PIECE_BLOCK_NUM];	//!< the offset address from the anchor cell (offsets[0]==0)
+};
+
+/*!
+配置表
+
+ボード上の各位置(基準セル)に置ける配置の一覧。
+placement[start[cell]] ... placement[start[cell+1]-1] が cell を基準セルとする配置。
+並びは find_solution の探索順(ピース番号、形状番号の順)と同じ。
+*/
+struct PlacementTable {
+	std::vector<int>		start;		//!< start index of placements for each cell. (size: cells + 1)
+	std::vector<Placement>	placement;	//!< placements
+};
+
+/*!
+配置の除外条件 (true:配置表から除外する)
+
+@param p 配置
+@param anchor 基準セルのボード上の位置
+*/
+typedef bool(*placement_filter_t)(const Placement& p, const int anchor, const void* arg);
+
+void build_placement_table(
+	PlacementTable& table,
+	const std::vector<Piece>& pieces,
+	const std::vector<int>& board,
+	placement_filter_t filter = NULL,
+	const void* filter_arg = NULL
+);
+
+void select_placement_table(
+	PlacementTable& table,
+	const PlacementTable& base,
+	const std::vector<int>& board,
+	placement_filter_t filter = NULL,
+	const void* filter_arg = NULL
+);
+
+bool find_solution_table(
+	const PlacementTable& table,
+	std::vector<bool>& used,
+	int* board_base,
+	int cell,
+	int* current_node,
+	const std::vector<int>& board,
+	SolutionSink& solution,
+	const bool find_all,
+	const int stride_num,
+	long long& call_num
+);
+
+
+//-----------------------------------------------------------------------------
+// solution renderer (render.cpp)
+
+/*!
+解の一括出力
+
+解を再利用するバッファに整形し、まとめて書き出す。
+色コードはピースが変わる時だけ出力する。
+*/
+class SolutionWriter {
+private:
+	const std::vector<Piece>& pieces;
+	print_format_t format;
+	FILE* fp;
+	std::vector<int> order;		//!< 出力順のボード上の位置 (ORDER_EOL:行末, ORDER_GAP:区切り)
+	std::vector<int> color_len;	//!< 色コードの長さ
+	std::vector<char> buff;		//!< 出力バッファ
+	size_t len;					//!< 出力バッファの使用量
+	size_t max_len;				//!< 1解あたりの最大出力サイズ
+	void Init(void);
+public:
+	enum {
+		ORDER_EOL = -1,		//!< 出力順の行末 (plain:改行, compact:'/')
+		ORDER_GAP = -2,		//!< 出力順の区切り (plain:空白, compact:'|')
+	};
+
+	SolutionWriter(const std::vector<Piece>& _pieces, const int rows, const int cols, const bool swap_ij, print_format_t _format = g_print_format, FILE* _fp = stdout);
+	SolutionWriter(const std::vector<Piece>& _pieces, const std::vector<int>& _order, print_format_t _format = g_print_format, FILE* _fp = stdout);
+	~SolutionWriter(void) { Flush(); }
+	void Write(const std::vector<int>& board, const int no);
+	void Flush(void);
+	std::string Str(void) const { return std::string(buff.data(), len); }	//!< 出力先がNULLの場合の出力内容
+	void Clear(void) { len = 0; }		//!< 出力先がNULLの場合の出力内容の破棄
+};
+
+void print_board(const std::vector<Piece>& pieces, const std::vector<int>& board, const int rows, const int cols, const bool swap_ij);
+
+
+//-----------------------------------------------------------------------------
+// constraint (constraint.cpp)
+
+/*!
+配置条件付きの探索問題
+
+配置条件を反映したボード(事前に配置したピース、穴)、使用済みフラグと配置表。
+*/
+struct ConstraintProblem {
+	std::vector<int>	board;		//!< ボード
+	std::vector<bool>	used;		//!< 事前に配置したピース
+	PlacementTable		table;		//!< 配置条件で絞り込んだ配置表
+	int					cell;		//!< 最初の空きセル
+	int					remain;		//!< 探索で配置するピースの数
+	bool				feasible;	//!< false:条件が矛盾している(解なし)
+};
+
+bool setup_constraint_problem(
+	ConstraintProblem& prob,
+	const std::vector<Piece>& pieces,
+	const PlacementTable* base,
+	const int rows,
+	const int cols,
+	const bool swap_ij,
+	const char* spec
+);
+
+int solve_constraint_problem(ConstraintProblem& prob, SolutionSink& solution, const bool find_all, const int stride_num, long long& call_num);
+
+
+//-----------------------------------------------------------------------------
+// server (server.cpp)
+
+std::string serve_request(const std::string& line);
+
+
+//-----------------------------------------------------------------------------
+// profile (profile.cpp)
+
+/*!
+処理のフェーズ
+*/
+enum profile_phase_t {
+	PROFILE_INIT_PIECES,		//!< init_pieces
+	PROFILE_BOARD_SETUP,		//!< board, placement table, task setup
+	PROFILE_SEARCH,				//!< search
+	PROFILE_OUTPUT,				//!< print solutions
+	PROFILE_PHASE_NUM
+};
+
+extern bool g_profile;			//!< フェーズ毎の処理時間を計測するか? (set by command line option)
+extern bool g_profile_hw;		//!< 探索中のハードウェアカウンタを計測するか? (set by command line option)
+
+void profile_add_phase(const profile_phase_t phase, const long long ns);
+long long profile_phase_ns(const profile_phase_t phase);
+
+/*!
+フェーズの処理時間の計測 (steady_clock, ns)
+*/
+class PhaseTimer {
+private:
+	profile_phase_t phase;
+	std::chrono::steady_clock::time_point start;
+public:
+	PhaseTimer(profile_phase_t _phase) : phase(_phase) { if (g_profile) start = std::chrono::steady_clock::now(); }
+	~PhaseTimer(void) {
+		if (g_profile) profile_add_phase(phase, std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+	}
+};
+
+/*!
+ハードウェアカウンタ (Linux: perf_event_open)
+
+呼び出したスレッドの探索中のイベント数を数える。
+Startを呼んだスレッドでStopを呼ぶこと。
+*/
+class PerfCounter {
+public:
+	enum { CYCLES, INSTRUCTIONS, BRANCH_MISSES, L1D_MISSES, LLC_MISSES, EVENT_NUM };
+	long long value[EVENT_NUM];		//!< イベント数 (-1:計測できない)
+	long long ns;					//!< 計測時間
+private:
+	int fd[EVENT_NUM];
+	std::chrono::steady_clock::time_point start;
+public:
+	PerfCounter(void);
+	~PerfCounter(void);
+	void Start(void);
+	void Stop(void);
+};
+
+void profile_add_thread(const int id, const PerfCounter& counter, const long long call_num);
+void print_profile_report(void);
+
+
+//-----------------------------------------------------------------------------
+// search tree estimation (estimate.cpp)
+
+/*!
+探索木の大きさの推定値 (Knuthの推定法)
+*/
+struct TreeEstimate {
+	int			probe_num;		//!< ランダムな試行(根から葉までの降下)の回数
+	double		nodes;			//!< 探索ノード数 (find_solution_tableの呼び出し回数)
+	double		nodes_error;	//!< nodesの標準誤差 (重い裾の分布なので、試行が少ないと過小になる)
+	double		nodes_max;		//!< 1回の試行の推定値の最大値 (合計に占める割合が大きいと、推定値は不安定)
+	double		solution_num;	//!< 解の数
+	double		node_ns;		//!< 1ノード当たりの処理時間 (試行の処理時間、estimate_subtrees では探索の処理時間から求める)
+	double		solution_density;	//!< 探索ノード当たりの解の数 (estimate_subtrees で求める)
+	long long	call_num;		//!< estimate_subtrees で探索したノード数
+	std::vector<double> level;	//!< 深さ毎の探索ノード数 (level[d]:ピースをd個配置したノード)
+};
+
+extern int g_progress_interval;	//!< 進捗表示の間隔[s] (0:表示しない, set by command line option)
+
+void estimate_tree(
+	TreeEstimate& estimate,
+	const PlacementTable& table,
+	std::vector<bool>& used,
+	std::vector<int>& board,
+	const int cell,
+	const int remain,
+	const int stride_num,
+	const int probe_num,
+	const unsigned int seed
+);
+double estimate_subtrees(
+	TreeEstimate& estimate,
+	const PlacementTable& table,
+	std::vector<bool>& used,
+	std::vector<int>& board,
+	const int cell,
+	const int remain,
+	const int stride_num,
+	const double max_ns,
+	const long long max_nodes,
+	const unsigned int seed
+);
+int choose_split_depth(const TreeEstimate& estimate, const int thread_num);
+
+
+//-----------------------------------------------------------------------------
+// parallel search (parallel.cpp)
+
+/*!
+部分木の根までの配置 (基準セル, 配置表の配置番号)
+
+タスクの番号は、逐次探索(深さ優先)で部分木を訪れる順になっている。
+*/
+typedef std::vector<std::pair<int, int>> ParallelTask;
+
+int split_parallel_tasks(
+	const PlacementTable& table,
+	std::vector<int>& board,
+	const int piece_num,
+	const int stride_num,
+	const int thread_num,
+	std::vector<ParallelTask>& tasks,
+	long long& call_num
+);
+
+bool search_parallel_task(
+	const PlacementTable& table,
+	const ParallelTask& task,
+	std::vector<bool>& used,
+	int* node,
+	std::vector<int>& board,
+	SolutionSink& solution,
+	const bool find_all,
+	const int stride_num,
+	long long& call_num
+);
+
+/*!
+並列探索の解の並べ替え
+
+タスク(部分木)毎に解を受け取り、タスクの番号順に次の受け取り先へ渡す。
+逐次探索と同じ順に解が並ぶ。
+先頭のタスク(それより前のタスクが全て完了している)の解はそのまま渡し、それ以外はタスク毎に溜めておく。
+先頭から window 個より後のタスクは、Acquire で先頭が進むまで待たせるので、溜める解はその範囲に限られる。
+*/
+class ReorderBuffer {
+private:
+	std::mutex mtx;
+	std::condition_variable cv;
+	SolutionSink& next;
+	const int window;							//!< 同時に実行するタスクの範囲
+	const bool find_all;						//!< 全ての解を見つけるか?
+	int head;									//!< 次に渡すタスク
+	int stop_task;								//!< これより後のタスクは不要 (!find_all で解が見つかった、または next.Done())
+	std::vector<std::vector<std::vector<int>>> slot;	//!< 完了したタスクの解 (task % window)
+	std::vector<bool> ready;					//!< タスクが完了したか? (task % window)
+public:
+	ReorderBuffer(SolutionSink& _next, const int _window, const bool _find_all);
+	bool Acquire(const int task);
+	void Push(const int task, const std::vector<int>& board, std::vector<std::vector<int>>& buffer);
+	void Complete(const int task, std::vector<std::vector<int>>& buffer);
+};
+
+/*!
+タスク毎の解の受け取り先 (ReorderBuffer へ渡す)
+*/
+class TaskSink : public SolutionSink {
+private:
+	ReorderBuffer& reorder;
+	int task;
+	std::vector<std::vector<int>> buffer;		//!< 先頭のタスクになるまで溜めておく解
+public:
+	TaskSink(ReorderBuffer& _reorder, const int _task) : reorder(_reorder), task(_task) {}
+	~TaskSink(void) { reorder.Complete(task, buffer); }
+	void Push(const std::vector<int>& board) { reorder.Push(task, board, buffer); }
+};
+
+
+//-----------------------------------------------------------------------------
+// solution archive (archive.cpp)
+
+/*!
+解のアーカイブの書き出し
+
+探索中に解を固定長のレコードとして書き出し、Closeで索引とヘッダを書き出す。
+ファイル形式は archive.cpp を参照。
+*/
+class ArchiveWriter : public SolutionSink {
+private:
+	FILE* fp;
+	std::string file_path;						//!< アーカイブファイル (エラー表示用)
+	int rows;									//!< 探索しているボードの行数
+	int cols;									//!< 探索しているボードの列数
+	bool swap_ij;
+	bool symmetry;								//!< 回転・鏡像による解を同一としているか?
+	bool write_error;							//!< 書き込みに失敗したか?
+	std::vector<char> names;					//!< ピース番号 -> ピース名
+	std::vector<int> order;						//!< 表示順のボード上の位置
+	std::vector<unsigned char> record;			//!< レコードの作業領域
+	std::vector<std::pair<unsigned long long, unsigned long long>> index;	//!< (fingerprint, 解の番号)
+public:
+	ArchiveWriter(void) : fp(NULL), write_error(false) {}
+	~ArchiveWriter(void) { Close(); }
+	bool Open(const char* path, const std::vector<Piece>& pieces, const int _rows, const int _cols, const bool _swap_ij, const bool _symmetry);
+	void Push(const std::vector<int>& board);
+	bool Close(void);
+};
+
+unsigned long long solution_fingerprint(const char* names, const size_t len);
+bool read_archive_fingerprints(const char* path, std::vector<unsigned long long>& fingerprints);
+
+#endif	/* _PENTOMINO_INTERNAL_H_ */
@@ -0,0 +1,260 @@
+﻿/*
+Copyright (c) 2016, oasi-adamay
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+* Neither the name of glsCV nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*!
+@file	placement.cpp
+@author	oasi-adamay
+@brief	配置表と、配置表による解の探索。
+*/
+
+//-----------------------------------------------------------------------------
+// generic include
+#include <stdio.h>
+#include <vector>
+#include <assert.h>
+
+#include "pentomino_internal.h"
+
+using namespace std;
+
+//-----------------------------------------------------------------------------
+// private functions
+
+/*!
+同じピースの配置の数(skip)を求める
+
+@param table 配置表
+@param begin 基準セルの先頭の配置
+*/
+static void update_skip(PlacementTable& table, const int begin){
+	const int end = (int)table.placement.size();
+	for (int n = end - 1; n >= begin; n--){
+		Placement& p = table.placement[n];
+		p.skip = (n + 1 < end && table.placement[n + 1].piece == p.piece) ? table.placement[n + 1].skip + 1 : 1;
+	}
+}
+
+//-----------------------------------------------------------------------------
+
+/*!
+配置表の生成
+
+ボードの各空きセルを基準セルとして、全てのピース・形状について、
+ボードの空きセルに収まる配置を列挙する。
+未使用かどうかは探索時に判定するので、ここでは確認しない。
+
+@param table		配置表 (出力)
+@param pieces		ペントミノデータ配列
+@param board		ボード (事前に配置したピースがあれば、そのセルには配置しない)
+@param filter		配置の除外条件 (NULL:除外しない)
+@param filter_arg	除外条件に渡す引数
+*/
+void build_placement_table(
+	PlacementTable& table,
+	const vector<Piece>& pieces,
+	const vector<int>& board,
+	placement_filter_t filter,
+	const void* filter_arg
+)
+{
+	const int cells = (int)board.size();
+
+	table.start.assign(cells + 1, 0);
+	table.placement.clear();
+
+	for (int cell = 0; cell < cells; cell++){
+		table.start[cell] = (int)table.placement.size();
+		if (board[cell] != BOARD_CELL_EMPTY) continue;
+
+		for (int i = 0; i < (int)pieces.size(); i++){
+			const Piece* piece = &pieces[i];
+			for (int j = 0; j < piece->shape_num; j++){
+				const int* offset = &(piece->shape[j].offsets[0]);
+
+				bool can_place = true;
+				for (int k = 0; k < PIECE_BLOCK_NUM; k++){
+					const int idx = cell + offset[k];
+					if (idx >= cells || board[idx] != BOARD_CELL_EMPTY) { can_place = false; break; }
+				}
+				if (!can_place) continue;
+
+				Placement p;
+				p.piece = i;
+				p.shape = j;
+				p.skip = 1;
+				for (int k = 0; k < PIECE_BLOCK_NUM; k++) p.offsets[k] = offset[k];
+				if (filter && filter(p, cell, filter_arg)) continue;
+
+				table.placement.push_back(p);
+			}
+		}
+		update_skip(table, table.start[cell]);
+	}
+	table.start[cells] = (int)table.placement.size();
+}
+
+
+/*!
+配置表の絞り込み
+
+ボードの空きセルに収まらない配置、除外条件に一致する配置を除いた配置表を作る。
+基準の配置表(空のボードで生成したもの)を使い回すことで、ピースの回転・反転からの生成を省く。
+
+@param table		配置表 (出力)
+@param base			基準の配置表 (boardと同じサイズのボードで生成したもの)
+@param board		ボード (事前に配置したピース、穴のセルには配置しない)
+@param filter		配置の除外条件 (NULL:除外しない)
+@param filter_arg	除外条件に渡す引数
+*/
+void select_placement_table(
+	PlacementTable& table,
+	const PlacementTable& base,
+	const vector<int>& board,
+	placement_filter_t filter,
+	const void* filter_arg
+)
+{
+	const int cells = (int)board.size();
+	assert((int)base.start.size() == cells + 1);
+
+	table.start.assign(cells + 1, 0);
+	table.placement.clear();
+
+	for (int cell = 0; cell < cells; cell++){
+		table.start[cell] = (int)table.placement.size();
+		if (board[cell] != BOARD_CELL_EMPTY) continue;
+
+		for (int n = base.start[cell]; n < base.start[cell + 1]; n++){
+			const Placement& p = base.placement[n];
+
+			bool can_place = true;
+			for (int k = 1; k < PIECE_BLOCK_NUM; k++){
+				if (board[cell + p.offsets[k]] != BOARD_CELL_EMPTY) { can_place = false; break; }
+			}
+			if (!can_place) continue;
+			if (filter && filter(p, cell, filter_arg)) continue;
+
+			table.placement.push_back(p);
+		}
+		update_skip(table, table.start[cell]);
+	}
+	table.start[cells] = (int)table.placement.size();
+}
+
+
+/*!
+配置表による解の探索
+
+find_solution と同じ探索を、ピース・形状の全数ではなく、
+現在のボード上の位置(cell)を基準セルとする配置表の配置だけで行う。
+
+@param table			配置表
+@param used				ペントミノが使用済かを表すフラグ配列
+@param board_base		ボードの先頭
+@param cell				現在のボード上の位置
+@param current_node		現在の探査ノード
+@param board			ボード
+@param solution			解のリスト
+@param find_all			全ての解を見つけるか?
+@param stride_num		ボードのstride
+@param call_num			探索ノード数 (呼び出し元のスレッドで集計する)
+
+@retuen ture:探索を終了した (!find_all で解を見つけた、または solution.Done())
+
+探索を終了した場合も、board・used・current_node は呼び出し時の状態に戻してから返る。
+(呼び出し元は、終了後も同じボードで別の部分木を探索できる)
+*/
+bool find_solution_table(
+	const PlacementTable& table,
+	vector<bool>& used,
+	int* board_base,
+	int cell,
+	int* current_node,
+	const vector<int>& board,
+	SolutionSink& solution,
+	const bool find_all,
+	const int stride_num,
+	long long& call_num
+)
+{
+	call_num++;
+
+	int* current_board = board_base + cell;
+	const Placement* p = table.placement.data() + table.start[cell];
+	const Placement* end = table.placement.data() + table.start[cell + 1];
+
+	for (; p != end; ++p){
+		const int i = p->piece;
+		if (used[i]) { p += p->skip - 1; continue; }		//使用済みのピースの配置を飛ばす
+
+		const int* offset = p->offsets;
+
+		//ピースが置けるかチェックする。
+		{
+			bool can_place = true;
+			for (int k = 1; k<PIECE_BLOCK_NUM; k++){		//k=0は自明
+				if (current_board[offset[k]] != BOARD_CELL_EMPTY) { can_place = false;  break; }
+			}
+			if (!can_place)	continue;
+		}
+
+		{	//更新　（ここでの操作は、下の修復と対になる)
+			for (int k = 0; k<PIECE_BLOCK_NUM; k++){ current_board[offset[k]] = i; }
+			used[i] = true;
+			*current_node++ = i;
+		}
+
+		bool done = false;
+		if (*(current_node) == END_OF_NODE){
+#ifdef _OPENMP
+#pragma omp critical
+#endif
+			{	solution.Push(board);	}
+
+			done = !find_all || solution.Done();
+		}
+		else{
+			int next = cell;
+			while (board_base[next] != BOARD_CELL_EMPTY){ next++; }
+			if (board_base[next + 1] == BOARD_CELL_EMPTY || board_base[next + stride_num] == BOARD_CELL_EMPTY)
+			{	//再帰
+				done = find_solution_table(table, used, board_base, next, current_node, board, solution, find_all, stride_num, call_num);
+			}
+		}
+
+		{	//修復　restore (探索を終了する場合も戻す)
+			for (int k = 0; k<PIECE_BLOCK_NUM; k++){ current_board[offset[k]] = BOARD_CELL_EMPTY; }
+			used[i] = false;
+			current_node--;
+		}
+		if (done) return true;
+	}
+	return false;
+}
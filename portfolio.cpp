@@ -0,0 +1,417 @@
+﻿/*
+Copyright (c) 2016, oasi-adamay
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+* Neither the name of glsCV nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*!
+@file	portfolio.cpp
+@author	oasi-adamay
+@brief	ポートフォリオ探索。設定の異なる複数の探索を並走させ、最初の解を採用する。
+*/
+
+//-----------------------------------------------------------------------------
+// generic include
+#include <stdio.h>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <random>
+#include <chrono>
+#include <assert.h>
+
+#include "pentomino.h"
+#include "pentomino_internal.h"
+
+using namespace std;
+
+/*!
+const & define macro
+*/
+#define PORTFOLIO_RESTART_UNIT	4096	//restart interval unit (nodes). multiplied by luby sequence.
+
+//-----------------------------------------------------------------------------
+
+/*!
+portfolio worker config
+*/
+struct portfolio_config_t {
+	bool		transpose;	//!< swap_ij の逆向き(行と列を入れ替えたボード)で探索する
+	bool		randomize;	//!< ピース順・形状順をランダム化し、リスタートしながら探索する
+	unsigned int seed;		//!< 乱数の種
+};
+
+/*!
+portfolio search result
+*/
+struct portfolio_result_t {
+	int			 winner;		//!< 解を見つけた worker (-1:解なし)
+	vector<Piece> pieces;		//!< winner のピースデータ(ボードのピース番号はこの並び)
+	vector<int>	 board;			//!< 解
+	int			 rows;			//!< winner が探索したボードの行数
+	int			 cols;			//!< winner が探索したボードの列数
+	bool		 transpose;		//!< winner が行と列を入れ替えて探索したか?
+	int			 restart_num;	//!< winner のリスタート回数
+	long long	 call_num;		//!< 全 worker の探索ノード数の合計
+};
+
+/*!
+探索の打ち切り制御
+*/
+struct race_state_t {
+	const atomic<bool>* stop;	//!< 他の worker が終了した
+	long long	node_limit;		//!< 探索ノード数の上限 (<0:上限なし)
+	long long	call_num;		//!< 探索ノード数 (worker local)
+};
+
+//-----------------------------------------------------------------------------
+// private functions
+
+/*!
+luby 数列 (1,1,2,1,1,2,4,1,1,2,...)
+
+@param i 1 origin の index
+*/
+static long long luby(int i){
+	int k = 1;
+	while ((1LL << k) - 1 < i) k++;
+	if (i == (1 << k) - 1) return 1LL << (k - 1);
+	return luby(i - (1 << (k - 1)) + 1);
+}
+
+/*!
+打ち切り付きの解の探索 (最初の解のみ)
+
+find_solution と同じ探索を行うが、他の worker の終了、およびノード数の上限で打ち切る。
+解を見つけた場合は、boardに解を残したまま return する。
+
+@return 1:解を見つけた 0:解なし(探索完了) -1:打ち切り
+*/
+static int find_solution_race(
+	const vector<Piece>& pieces,
+	vector<bool>& used,
+	int* current_board,
+	int* current_node,
+	const int stride_num,
+	race_state_t& st
+)
+{
+	st.call_num++;
+	if (st.stop->load(memory_order_relaxed)) return -1;
+	if (st.node_limit >= 0 && st.call_num > st.node_limit) return -1;
+
+	const int n = (int)used.size();
+
+	//未使用のピースの全てを探索
+	for (int i = 0; i < n; i++){
+		if (used[i]) { continue; }
+
+		const Piece* piece = &pieces[i];
+
+		//全ての配置で探索
+		for (int j = 0; j < piece->shape_num; j++){
+			const int* offset = &(piece->shape[j].offsets[0]);
+
+			//ピースが置けるかチェックする。
+			{
+				bool can_place = true;
+				for (int k = 1; k<PIECE_BLOCK_NUM; k++){		//k=0は自明
+					if (current_board[offset[k]] != BOARD_CELL_EMPTY) { can_place = false;  break; }
+				}
+				if (!can_place)	continue;
+			}
+
+			{	//更新
+				for (int k = 0; k<PIECE_BLOCK_NUM; k++){ current_board[offset[k]] = i; }
+				used[i] = true;
+				*current_node++ = i;
+			}
+
+			if (*(current_node) == END_OF_NODE){
+				return 1;		//解をboardに残したまま返る
+			}
+			else{
+				int* next_board = current_board;
+				while (*next_board != BOARD_CELL_EMPTY){ next_board++; }
+				if (next_board[1] == BOARD_CELL_EMPTY || next_board[stride_num] == BOARD_CELL_EMPTY)
+				{	//再帰
+					int ret = find_solution_race(pieces, used, next_board, current_node, stride_num, st);
+					if (ret != 0) return ret;
+				}
+			}
+
+			{	//修復　restore
+				for (int k = 0; k<PIECE_BLOCK_NUM; k++){ current_board[offset[k]] = BOARD_CELL_EMPTY; }
+				used[i] = false;
+				current_node--;
+			}
+		}
+	}
+	return 0;
+}
+
+/*!
+ピース順のランダム化
+
+形状数の少ない順(sort_pieces_by_shape_num)は保ったまま、同じ形状数のピースの順番、
+および各ピースの形状の順番をランダムに入れ替える。
+また、対称性除去(remove_redundant_shape)に使うピースと、残す形状もランダムに選ぶ。
+
+@param pieces 出力先
+@param base 冗長な形状を削除していないピースデータ
+@param rng 乱数生成器
+*/
+static void randomize_pieces(vector<Piece>& pieces, const vector<Piece>& base, mt19937& rng){
+	pieces = base;
+	shuffle(pieces.begin(), pieces.end(), rng);
+
+	//対称性除去: 長方形ボードの対称変換(恒等,180度回転,上下反転,左右反転)で
+	//形状 {0,2,4,6} と {1,3,5,7} はそれぞれ互いに移りあう。各組から一つずつ残す。
+	vector<int> candidates;
+	for (int i = 0; i < (int)pieces.size(); i++){
+		if (pieces[i].shape_num == 8) candidates.push_back(i);
+	}
+	if (!candidates.empty()){
+		Piece& p = pieces[candidates[rng() % candidates.size()]];
+		const int a = 2 * (int)(rng() % 4);
+		const int b = 2 * (int)(rng() % 4) + 1;
+		auto sa = p.shape[a];
+		auto sb = p.shape[b];
+		p.shape[0] = sa;
+		p.shape[1] = sb;
+		p.shape_num = 2;
+	}
+
+	for (int i = 0; i < (int)pieces.size(); i++){
+		shuffle(&pieces[i].shape[0], &pieces[i].shape[pieces[i].shape_num], rng);
+	}
+
+	stable_sort(pieces.begin(), pieces.end(), [](const Piece& a, const Piece& b){ return a.shape_num < b.shape_num; });
+}
+
+/*!
+portfolio worker
+
+@param cfg worker の設定
+@param rows 探索するボードの行数 (transposeは適用済み)
+@param cols 探索するボードの列数 (transposeは適用済み)
+*/
+static void portfolio_worker(
+	const int id,
+	const portfolio_config_t cfg,
+	const int rows,
+	const int cols,
+	atomic<bool>& stop,
+	atomic<int>& winner,
+	atomic<long long>& call_num,
+	portfolio_result_t& result
+)
+{
+	vector<Piece> base;
+	vector<Piece> pieces;
+	mt19937 rng(cfg.seed);
+
+	if (cfg.randomize){
+		init_pieces(base, rows, cols, false);
+	}
+	else{
+		init_pieces(pieces, rows, cols);
+	}
+
+	const int piece_num = (int)(cfg.randomize ? base.size() : pieces.size());
+	race_state_t st = { &stop, -1, 0 };
+	int restart = 0;
+
+	for (;;) {
+		if (cfg.randomize){
+			restart++;
+			randomize_pieces(pieces, base, rng);
+			st.node_limit = st.call_num + luby(restart) * PORTFOLIO_RESTART_UNIT;
+		}
+
+		vector<bool> used(piece_num, false);
+		vector<int>  node(piece_num + 1, 0);
+		node[piece_num] = END_OF_NODE;
+		vector<int>  board = create_board(rows, cols);
+
+		int ret = find_solution_race(pieces, used, &board[0], &node[0], cols + 1, st);
+		if (ret < 0 && !stop.load()) continue;		//リスタート
+		if (ret < 0) break;							//他の worker が終了した
+
+		//解を見つけた、または探索を完了した(解なし)。最初の worker だけが結果を残す。
+		int expected = -1;
+		if (winner.compare_exchange_strong(expected, ret > 0 ? id : INT_MAX)){
+			if (ret > 0){
+				result.pieces = pieces;
+				result.board = board;
+				result.rows = rows;
+				result.cols = cols;
+				result.transpose = cfg.transpose;
+				result.restart_num = cfg.randomize ? restart - 1 : 0;
+			}
+			stop.store(true);
+		}
+		break;
+	}
+
+	call_num += st.call_num;
+}
+
+/*!
+ポートフォリオ探索の実行
+
+worker 0 は solve_pentomino と同じ探索、worker 1 は行と列を入れ替えた探索、
+worker 2 以降はランダム化した探索をリスタートしながら行う(奇数番目は行と列を入れ替える)。
+
+@return true:解を見つけた
+*/
+static bool run_portfolio(int rows, int cols, int worker_num, unsigned int seed, portfolio_result_t& result){
+	if (worker_num <= 0) worker_num = (int)thread::hardware_concurrency();
+	if (worker_num <= 0) worker_num = 1;
+
+	atomic<bool> stop(false);
+	atomic<int> winner(-1);
+	atomic<long long> call_num(0);
+
+	vector<thread> threads;
+	for (int id = 0; id < worker_num; id++){
+		portfolio_config_t cfg;
+		cfg.transpose = (id % 2) == 1;
+		cfg.randomize = id >= 2;
+		cfg.seed = seed + id;
+
+		const int r = cfg.transpose ? cols : rows;
+		const int c = cfg.transpose ? rows : cols;
+		threads.push_back(thread(portfolio_worker, id, cfg, r, c, ref(stop), ref(winner), ref(call_num), ref(result)));
+	}
+	for (auto& th : threads) th.join();
+
+	result.winner = (winner.load() == INT_MAX) ? -1 : winner.load();
+	result.call_num = call_num.load();
+	return result.winner >= 0;
+}
+
+/*!
+分布の表示 (min / p50 / p90 / max / mean)
+*/
+static void print_distribution(const char* label, vector<double> t){
+	sort(t.begin(), t.end());
+	double sum = 0;
+	for (double v : t) sum += v;
+	const int n = (int)t.size();
+	printf("%s\tmin:%.3f\tp50:%.3f\tp90:%.3f\tmax:%.3f\tmean:%.3f [ms]\n",
+		label, t[0], t[n / 2], t[(n * 9) / 10 < n ? (n * 9) / 10 : n - 1], t[n - 1], sum / n);
+}
+
+//-----------------------------------------------------------------------------
+// public functions
+
+/*!
+ペントミノの解を一つ見つける。(ポートフォリオ探索)
+
+@param rows 配置するボードの行数
+@param cols 配置するボードの列数
+@param swap_ij 行と列を入れ替えて探索しているか?(表示時に戻す)
+@param worker_num 並走させる探索の数 (0:コア数)
+@param seed 乱数の種
+
+@return 解の数 (0 or 1)
+*/
+int solve_pentomino_portfolio(int rows, int cols, const bool swap_ij, int worker_num, unsigned int seed){
+	assert(rows > 0);
+	assert(cols > 0);
+
+	//自明な条件の削除
+	{
+		vector<Piece> pieces;
+		init_pieces(pieces, rows, cols);
+		if ((int)pieces.size()*PIECE_BLOCK_NUM > (rows*cols)) return 0;
+	}
+
+	portfolio_result_t result;
+	{
+		Timer tmr("process time:\t");
+		run_portfolio(rows, cols, worker_num, seed, result);
+	}
+	g_find_solution_call_num += result.call_num;
+
+	if (result.winner < 0) return 0;
+
+	printf("winner: worker %d (transpose:%d restart:%d)\n", result.winner, result.transpose, result.restart_num);
+	printf("#%d\n", 1);
+	print_board(result.pieces, result.board, result.rows, result.cols, result.transpose ? !swap_ij : swap_ij);
+
+	return 1;
+}
+
+/*!
+ポートフォリオ探索のベンチマーク
+
+@param rows 配置するボードの行数
+@param cols 配置するボードの列数
+@param swap_ij 行と列を入れ替えて探索しているか?
+@param worker_num 並走させる探索の数 (0:コア数)
+@param seed_num 試行する seed の数
+*/
+void bench_pentomino_portfolio(int rows, int cols, const bool swap_ij, int worker_num, int seed_num){
+	assert(rows > 0);
+	assert(cols > 0);
+	(void)swap_ij;
+
+	if (worker_num <= 0) worker_num = (int)thread::hardware_concurrency();
+	if (worker_num <= 0) worker_num = 1;
+	if (seed_num <= 0) seed_num = 1;
+
+	vector<double> seq_time;
+	vector<double> pf_time;
+	vector<int> win_num(worker_num, 0);
+
+	for (int s = 0; s < seed_num; s++){
+		portfolio_result_t result;
+
+		//逐次探索 (worker 0 のみ = solve_pentomino と同じ探索順)
+		auto t0 = chrono::steady_clock::now();
+		run_portfolio(rows, cols, 1, 0, result);
+		auto t1 = chrono::steady_clock::now();
+		seq_time.push_back(chrono::duration<double, milli>(t1 - t0).count());
+
+		t0 = chrono::steady_clock::now();
+		run_portfolio(rows, cols, worker_num, (unsigned int)s * 7919u + 1u, result);
+		t1 = chrono::steady_clock::now();
+		pf_time.push_back(chrono::duration<double, milli>(t1 - t0).count());
+
+		if (result.winner >= 0) win_num[result.winner]++;
+	}
+
+	printf("time to first solution (%d seeds, %d workers)\n", seed_num, worker_num);
+	print_distribution("sequential:", seq_time);
+	print_distribution("portfolio: ", pf_time);
+	for (int id = 0; id < worker_num; id++){
+		printf("worker %d won:\t%d\n", id, win_num[id]);
+	}
+}
@@ -0,0 +1,240 @@
+﻿/*
+Copyright (c) 2016, oasi-adamay
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+* Neither the name of glsCV nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*!
+@file	profile.cpp
+@author	oasi-adamay
+@brief	フェーズ毎の処理時間と、探索中のハードウェアカウンタの計測・表示。
+*/
+
+//-----------------------------------------------------------------------------
+// generic include
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <vector>
+#include <algorithm>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+#include "pentomino_internal.h"
+
+using namespace std;
+
+/*!
+global var. (profile option)
+*/
+bool g_profile = false;
+bool g_profile_hw = false;
+
+//-----------------------------------------------------------------------------
+
+/*!
+スレッド毎の計測結果
+*/
+struct profile_thread_t {
+	int			id;			//!< thread id
+	long long	call_num;	//!< 探索ノード数
+	PerfCounter	counter;	//!< ハードウェアカウンタ
+};
+
+static atomic<long long> s_phase_ns[PROFILE_PHASE_NUM];
+static mutex s_thread_mtx;
+static vector<profile_thread_t> s_threads;
+static atomic<int> s_perf_errno(0);		//!< perf_event_open のエラー (各スレッドの PerfCounter::Start で書く)
+
+static const char* s_phase_name[PROFILE_PHASE_NUM] = { "init_pieces", "board_setup", "search", "output" };
+static const char* s_event_name[PerfCounter::EVENT_NUM] = { "cycles", "instructions", "branch-misses", "L1D-misses", "LLC-misses" };
+
+//-----------------------------------------------------------------------------
+// PerfCounter
+
+PerfCounter::PerfCounter(void) : ns(0) {
+	for (int e = 0; e < EVENT_NUM; e++) { value[e] = -1; fd[e] = -1; }
+}
+
+PerfCounter::~PerfCounter(void) {
+#ifdef __linux__
+	for (int e = 0; e < EVENT_NUM; e++) if (fd[e] >= 0) close(fd[e]);
+#endif
+}
+
+/*!
+計測開始 (g_profile_hw が無効の場合は時間のみ計測する)
+*/
+void PerfCounter::Start(void) {
+#ifdef __linux__
+	if (g_profile_hw) {
+		static const struct { unsigned int type; unsigned long long config; } events[EVENT_NUM] = {
+			{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+			{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+			{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+			{ PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+			{ PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+		};
+
+		for (int e = 0; e < EVENT_NUM; e++) {
+			struct perf_event_attr attr;
+			memset(&attr, 0, sizeof(attr));
+			attr.size = sizeof(attr);
+			attr.type = events[e].type;
+			attr.config = events[e].config;
+			attr.disabled = 1;
+			attr.exclude_kernel = 1;
+			attr.exclude_hv = 1;
+			attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+			//pid=0, cpu=-1 : 呼び出したスレッドのみ
+			fd[e] = (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+			if (fd[e] < 0) { s_perf_errno = errno; continue; }
+			ioctl(fd[e], PERF_EVENT_IOC_RESET, 0);
+			ioctl(fd[e], PERF_EVENT_IOC_ENABLE, 0);
+		}
+	}
+#endif
+	start = chrono::steady_clock::now();
+}
+
+/*!
+計測終了
+*/
+void PerfCounter::Stop(void) {
+	ns = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+#ifdef __linux__
+	for (int e = 0; e < EVENT_NUM; e++) {
+		if (fd[e] < 0) continue;
+		ioctl(fd[e], PERF_EVENT_IOC_DISABLE, 0);
+
+		unsigned long long buf[3];		//value, time_enabled, time_running
+		if (read(fd[e], buf, sizeof(buf)) == sizeof(buf) && buf[2] > 0) {
+			//多重化された場合は、計測時間の比で補正する
+			value[e] = (long long)((double)buf[0] * buf[1] / buf[2]);
+		}
+		close(fd[e]);
+		fd[e] = -1;
+	}
+#endif
+}
+
+//-----------------------------------------------------------------------------
+
+/*!
+フェーズの処理時間を加算する
+*/
+void profile_add_phase(const profile_phase_t phase, const long long ns) {
+	s_phase_ns[phase] += ns;
+}
+
+/*!
+フェーズの処理時間の累計 [ns]
+*/
+long long profile_phase_ns(const profile_phase_t phase) {
+	return s_phase_ns[phase].load();
+}
+
+/*!
+スレッドの計測結果を登録する
+*/
+void profile_add_thread(const int id, const PerfCounter& counter, const long long call_num) {
+	if (!g_profile) return;
+	lock_guard<mutex> lock(s_thread_mtx);
+	profile_thread_t t;
+	t.id = id;
+	t.call_num = call_num;
+	t.counter.ns = counter.ns;
+	for (int e = 0; e < PerfCounter::EVENT_NUM; e++) t.counter.value[e] = counter.value[e];
+	s_threads.push_back(t);
+}
+
+/*!
+計測結果の表示
+*/
+void print_profile_report(void) {
+	if (!g_profile) return;
+
+	printf("profile (steady_clock)\n");
+	for (int p = 0; p < PROFILE_PHASE_NUM; p++) {
+		printf("%-12s\t%lld [ns]\n", s_phase_name[p], s_phase_ns[p].load());
+	}
+
+	lock_guard<mutex> lock(s_thread_mtx);
+	if (s_threads.empty()) return;
+
+	printf("thread\tnodes\ttime[ns]");
+	for (int e = 0; e < PerfCounter::EVENT_NUM; e++) printf("\t%s", s_event_name[e]);
+	printf("\tIPC\tnodes/cycle\n");
+
+	profile_thread_t total;
+	total.id = -1;
+	total.call_num = 0;
+	total.counter.ns = 0;
+	for (int e = 0; e < PerfCounter::EVENT_NUM; e++) total.counter.value[e] = 0;
+
+	auto print_row = [](const char* label, const profile_thread_t& t) {
+		printf("%s\t%lld\t%lld", label, t.call_num, t.counter.ns);
+		for (int e = 0; e < PerfCounter::EVENT_NUM; e++) {
+			if (t.counter.value[e] < 0) printf("\tn/a");
+			else printf("\t%lld", t.counter.value[e]);
+		}
+		const long long cycles = t.counter.value[PerfCounter::CYCLES];
+		const long long instructions = t.counter.value[PerfCounter::INSTRUCTIONS];
+		if (cycles > 0 && instructions >= 0) printf("\t%.3f", (double)instructions / cycles);
+		else printf("\tn/a");
+		if (cycles > 0) printf("\t%.6f\n", (double)t.call_num / cycles);
+		else printf("\tn/a\n");
+	};
+
+	sort(s_threads.begin(), s_threads.end(), [](const profile_thread_t& a, const profile_thread_t& b) { return a.id < b.id; });
+	for (auto& t : s_threads) {
+		char label[16];
+		snprintf(label, sizeof(label), "%d", t.id);
+		print_row(label, t);
+
+		total.call_num += t.call_num;
+		total.counter.ns += t.counter.ns;
+		for (int e = 0; e < PerfCounter::EVENT_NUM; e++) {
+			if (t.counter.value[e] < 0 || total.counter.value[e] < 0) total.counter.value[e] = -1;
+			else total.counter.value[e] += t.counter.value[e];
+		}
+	}
+	if (s_threads.size() > 1) print_row("total", total);
+
+	if (g_profile_hw && s_perf_errno) {
+		printf("hardware counter is not available: %s\n", strerror(s_perf_errno.load()));
+	}
+}
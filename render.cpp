@@ -0,0 +1,198 @@
+﻿/*
+Copyright (c) 2016, oasi-adamay
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+* Neither the name of glsCV nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*!
+@file	render.cpp
+@author	oasi-adamay
+@brief	解の表示。解をバッファに整形してまとめて書き出す。
+*/
+
+//-----------------------------------------------------------------------------
+// generic include
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include "pentomino_internal.h"
+
+using namespace std;
+
+/*!
+const & define macro
+*/
+#define WRITER_FLUSH_SIZE	(1 << 16)			//flush size of output buffer
+#define COLOR_RESET		"\x1b[49m\x1b[39m"		//reset color code
+#define CELL_EMPTY_CHAR	' '						//print char of empty cell
+#define CELL_HOLE_CHAR	'#'						//print char of hole (BOARD_CELL_BOARDER inside the board)
+
+
+//-----------------------------------------------------------------------------
+// SolutionWriter
+
+/*!
+@param _pieces ペントミノデータ配列 (ボード上のピース番号に対応)
+@param rows ボードの行数
+@param cols ボードの列数
+@param swap_ij 行と列を入れ替えて表示するか?
+@param _format 表示形式
+@param _fp 出力先 (NULL:バッファに溜めて、Strで取り出す)
+*/
+SolutionWriter::SolutionWriter(const vector<Piece>& _pieces, const int rows, const int cols, const bool swap_ij, print_format_t _format, FILE* _fp)
+	: pieces(_pieces), format(_format), fp(_fp), len(0), max_len(0)
+{
+	//出力順のボード上の位置を事前に求めておく
+	if (swap_ij) {
+		for (int x = 0; x < cols; x++) {
+			for (int y = 0; y < rows; y++) order.push_back(y * (cols + 1) + x);
+			order.push_back(ORDER_EOL);
+		}
+	}
+	else {
+		for (int y = 0; y < rows; y++) {
+			for (int x = 0; x < cols; x++) order.push_back(y * (cols + 1) + x);
+			order.push_back(ORDER_EOL);
+		}
+	}
+	Init();
+}
+
+/*!
+出力順を指定した解の一括出力 (立体の層を並べる場合など)
+
+@param _pieces ペントミノデータ配列 (ボード上のピース番号に対応)
+@param _order 出力順のボード上の位置 (ORDER_EOL:行末, ORDER_GAP:区切り, 最後は ORDER_EOL)
+@param _format 表示形式
+@param _fp 出力先 (NULL:バッファに溜めて、Strで取り出す)
+*/
+SolutionWriter::SolutionWriter(const vector<Piece>& _pieces, const vector<int>& _order, print_format_t _format, FILE* _fp)
+	: pieces(_pieces), format(_format), fp(_fp), order(_order), len(0), max_len(0)
+{
+	Init();
+}
+
+/*!
+出力バッファの確保
+*/
+void SolutionWriter::Init(void)
+{
+	size_t max_color_len = 0;
+	for (int i = 0; i < (int)pieces.size(); i++) {
+		color_len.push_back((int)strlen(pieces[i].color));
+		if (color_len[i] > (int)max_color_len) max_color_len = color_len[i];
+	}
+
+	//1解あたりの最大出力サイズ  (番号 + 全セルに色コード + 行末の色リセット)
+	max_len = 32 + order.size() * (max_color_len + sizeof(COLOR_RESET) + 1);
+	buff.resize(WRITER_FLUSH_SIZE + max_len);
+}
+
+/*!
+解の出力
+
+@param board 解のボード
+@param no 解の番号 (0以下:番号を表示しない)
+*/
+void SolutionWriter::Write(const vector<int>& board, const int no)
+{
+	if (len + max_len > buff.size()) buff.resize(buff.size() * 2);	//出力先がNULLの場合
+	char* dst = &buff[len];
+
+	if (no > 0 && format != PRINT_FORMAT_COMPACT) {
+		dst += sprintf(dst, "#%d\n", no);
+	}
+
+	if (format == PRINT_FORMAT_COLOR) {
+		int prev = BOARD_CELL_EMPTY;		//現在の色 (BOARD_CELL_EMPTY:色なし)
+		for (int idx : order) {
+			if (idx < 0) {
+				if (prev != BOARD_CELL_EMPTY) {
+					memcpy(dst, COLOR_RESET, sizeof(COLOR_RESET) - 1);
+					dst += sizeof(COLOR_RESET) - 1;
+					prev = BOARD_CELL_EMPTY;
+				}
+				*dst++ = (idx == ORDER_EOL) ? '\n' : ' ';
+				continue;
+			}
+			const int n = (board[idx] == BOARD_CELL_BOARDER) ? BOARD_CELL_EMPTY : board[idx];
+			if (n != prev) {	//ピースが変わった時だけ色コードを出力
+				if (n == BOARD_CELL_EMPTY) {
+					memcpy(dst, COLOR_RESET, sizeof(COLOR_RESET) - 1);
+					dst += sizeof(COLOR_RESET) - 1;
+				}
+				else {
+					memcpy(dst, pieces[n].color, color_len[n]);
+					dst += color_len[n];
+				}
+				prev = n;
+			}
+			*dst++ = (n != BOARD_CELL_EMPTY) ? pieces[n].name : (board[idx] == BOARD_CELL_BOARDER) ? CELL_HOLE_CHAR : CELL_EMPTY_CHAR;
+		}
+		*dst++ = '\n';
+	}
+	else {
+		const char eol = (format == PRINT_FORMAT_COMPACT) ? '/' : '\n';
+		const char gap = (format == PRINT_FORMAT_COMPACT) ? '|' : ' ';
+		for (int idx : order) {
+			if (idx < 0) { *dst++ = (idx == ORDER_EOL) ? eol : gap; continue; }
+			const int n = board[idx];
+			*dst++ = (n == BOARD_CELL_EMPTY) ? CELL_EMPTY_CHAR : (n == BOARD_CELL_BOARDER) ? CELL_HOLE_CHAR : pieces[n].name;
+		}
+		if (format == PRINT_FORMAT_COMPACT) dst[-1] = '\n';
+		else *dst++ = '\n';
+	}
+
+	len = dst - &buff[0];
+	if (len >= WRITER_FLUSH_SIZE && fp) Flush();
+}
+
+/*!
+出力バッファの書き出し
+*/
+void SolutionWriter::Flush(void)
+{
+	if (fp == NULL) return;
+	if (len > 0) {
+		fwrite(&buff[0], 1, len, fp);
+		len = 0;
+	}
+	fflush(fp);
+}
+
+
+//-----------------------------------------------------------------------------
+
+/*!
+ボードの表示
+*/
+void print_board(const vector<Piece>& pieces, const vector<int>& board, const int rows, const int cols, const bool swap_ij)
+{
+	SolutionWriter writer(pieces, rows, cols, swap_ij);
+	writer.Write(board, 0);
+}
@@ -0,0 +1,426 @@
+﻿/*
+Copyright (c) 2016, oasi-adamay
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+* Neither the name of glsCV nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*!
+@file	sample.cpp
+@author	oasi-adamay
+@brief	解の一様ランダムなサンプリング。全ての解を列挙せず、根から葉への重み付きの降下で解を選ぶ。
+*/
+
+//-----------------------------------------------------------------------------
+// generic include
+#include <stdio.h>
+#include <float.h>
+#include <vector>
+#include <random>
+#include <unordered_map>
+#include <algorithm>
+#include <chrono>
+#include <assert.h>
+
+#include "pentomino.h"
+#include "pentomino_internal.h"
+
+using namespace std;
+
+/*!
+const & define macro
+*/
+#define SAMPLE_PROBES			16		//number of probes to estimate the solutions of a subtree
+#define SAMPLE_ROOT_PROBES		1024	//number of probes to estimate the whole tree
+#define SAMPLE_DENSITY_NODES	1000000	//nodes to search random subtrees to estimate the solution density
+#define SAMPLE_PRIOR_RATIO		0.5		//ratio of the prior (nodes x solution density of the whole tree) mixed into the estimate
+#define SAMPLE_EXACT_NODES		16384	//count the solutions of the subtree exactly if the estimated nodes are less than this
+#define SAMPLE_EXACT_BUDGET		65536	//give up counting exactly (use the estimate) if the subtree has more nodes than this
+#define SAMPLE_EXACT_REMAIN		4		//count the solutions of the subtree exactly without the estimation if the remaining pieces are less than or equal to this
+#define SAMPLE_PILOT_ATTEMPTS	256		//number of descents to estimate the number of solutions (acceptance bound)
+#define SAMPLE_ACCEPT_SCALE		4.0		//scale of the acceptance bound (multiplied by the estimated number of solutions)
+#define SAMPLE_MAX_ATTEMPTS		1000000	//max attempts per sample
+
+//-----------------------------------------------------------------------------
+
+/*!
+サンプリングの状態
+
+部分木の重み(解の数の推定値)は、盤面(Zobristハッシュ)毎に記憶して使い回し、降下で訪れる度に子ノードの重みの合計で更新する。
+降下で解を選ぶ確率は、その降下で使った重みから求めるので、重みが更新されても棄却による補正は正しく働く。
+*/
+struct Sampler {
+	const PlacementTable&	table;
+	vector<int>&			board;
+	vector<bool>			used;
+	const int				piece_num;
+	const int				stride_num;
+	mt19937					rng;
+	vector<unsigned long long>	zobrist;		//!< (セル, ピース)毎の乱数
+	unordered_map<unsigned long long, double>	memo;	//!< 盤面毎の重み
+	vector<int>				node;			//!< 解の数を数える探索の探査ノード
+	double					density;		//!< 探索木全体の解の数/探索ノード数
+	long long				call_num;		//!< 探索ノード数 (解の数を数える探索と降下で訪れたノード)
+
+	Sampler(const PlacementTable& _table, vector<int>& _board, const int _piece_num, const int _stride_num, const unsigned int seed)
+		: table(_table), board(_board), used(_piece_num, false), piece_num(_piece_num), stride_num(_stride_num), rng(seed), node(_piece_num + 1, END_OF_NODE), density(0.0), call_num(0)
+	{
+		mt19937_64 key_rng(0);
+		zobrist.resize(board.size() * piece_num);
+		for (auto& z : zobrist) z = key_rng();
+	}
+
+	unsigned long long Key(const int cell, const Placement& p) const {
+		unsigned long long key = 0;
+		for (int k = 0; k < PIECE_BLOCK_NUM; k++) key ^= zobrist[(cell + p.offsets[k]) * piece_num + p.piece];
+		return key;
+	}
+
+	void Place(const int cell, const Placement& p, const int value){
+		for (int k = 0; k < PIECE_BLOCK_NUM; k++){ board[cell + p.offsets[k]] = value; }
+	}
+
+	double Init(const int cell);
+	double Count(const int cell, const int remain);
+	double Exact(const unsigned long long key, const int cell, const int remain, long long& budget);
+	double Weight(const unsigned long long key, const int cell, const int remain);
+	double Descend(vector<pair<int, int>>& placed);
+	void Restore(vector<pair<int, int>>& placed);
+};
+
+/*!
+探索木全体の解の数の推定
+
+@return 解の数の推定値 (小さい探索木では、全探索した解の数)
+*/
+double Sampler::Init(const int cell){
+	TreeEstimate estimate;
+	estimate_tree(estimate, table, used, board, cell, piece_num, stride_num, SAMPLE_ROOT_PROBES, (unsigned int)rng());
+
+	double weight;
+	if (estimate.nodes < SAMPLE_EXACT_NODES){
+		weight = Count(cell, piece_num);
+	}
+	else{
+		estimate_subtrees(estimate, table, used, board, cell, piece_num, stride_num, DBL_MAX, SAMPLE_DENSITY_NODES, (unsigned int)rng());
+		call_num += estimate.call_num;
+		weight = max(estimate.nodes * estimate.solution_density, 1.0);
+	}
+	density = estimate.nodes > 0.0 ? weight / estimate.nodes : 0.0;
+	memo[0] = weight;
+	return weight;
+}
+
+/*!
+部分木の解の数 (全探索)
+*/
+double Sampler::Count(const int cell, const int remain){
+	SolutionList solution(0);
+	for (int n = 0; n < remain; n++) node[n] = 0;
+	node[remain] = END_OF_NODE;
+	find_solution_table(table, used, &board[0], cell, &node[0], board, solution, true, stride_num, call_num);
+	return solution.num;
+}
+
+/*!
+部分木の解の数 (全探索, 部分木の各ノードの解の数も記憶する)
+
+降下が全探索した部分木に入ると、子ノードの重みはmemoから引けるので、部分木を数え直さない。
+未配置のピースが SAMPLE_EXACT_REMAIN 以下のノードは記憶せず、Countで数える。(memoの大きさを抑える)
+推定が小さすぎた部分木を数え続けないよう、探索ノード数が budget を超えたら諦める。
+(数え終えた子ノードの解の数は記憶に残る)
+
+@param budget 探索できるノード数 (探索したノード数を引く)
+
+@return 解の数 (-1:budget を超えた)
+*/
+double Sampler::Exact(const unsigned long long key, const int cell, const int remain, long long& budget){
+	auto itr = memo.find(key);
+	if (itr != memo.end()) return itr->second;
+	if (remain <= SAMPLE_EXACT_REMAIN) {
+		const long long start = call_num;
+		const double c = Count(cell, remain);
+		budget -= call_num - start;
+		return c;
+	}
+	if (--budget < 0) return -1.0;
+
+	call_num++;
+	double total = 0.0;
+	const int* current_board = &board[cell];
+	for (int n = table.start[cell]; n < table.start[cell + 1]; n++){
+		const Placement& p = table.placement[n];
+		if (used[p.piece]) { n += p.skip - 1; continue; }
+
+		bool can_place = true;
+		for (int k = 1; k < PIECE_BLOCK_NUM; k++){
+			if (current_board[p.offsets[k]] != BOARD_CELL_EMPTY) { can_place = false; break; }
+		}
+		if (!can_place) continue;
+
+		Place(cell, p, p.piece);
+		used[p.piece] = true;
+		int next = cell;
+		while (board[next] != BOARD_CELL_EMPTY){ next++; }
+		if (board[next + 1] == BOARD_CELL_EMPTY || board[next + stride_num] == BOARD_CELL_EMPTY){
+			const double c = Exact(key ^ Key(cell, p), next, remain - 1, budget);
+			total = (c < 0.0 || total < 0.0) ? -1.0 : total + c;
+		}
+		used[p.piece] = false;
+		Place(cell, p, BOARD_CELL_EMPTY);
+		if (total < 0.0) return -1.0;
+	}
+	memo[key] = total;
+	return total;
+}
+
+/*!
+部分木の重み
+
+ランダムな試行で部分木の大きさを推定し、小さい部分木は全探索して解の数を数える。(解のない部分木は重み0)
+全探索が SAMPLE_EXACT_BUDGET を超えた場合は、大きい部分木と同じく推定値を使う。
+未配置のピースが SAMPLE_EXACT_REMAIN 以下なら、推定せずに全探索する。
+大きい部分木は、解の数の推定値と、探索ノード数 × 探索木全体の解の密度 を SAMPLE_PRIOR_RATIO で混ぜたものとする。
+(試行で解が見つからなくても、部分木の大きさに応じて選ばれるように)
+*/
+double Sampler::Weight(const unsigned long long key, const int cell, const int remain){
+	auto itr = memo.find(key);
+	if (itr != memo.end()) return itr->second;
+
+	TreeEstimate estimate;
+	if (remain > SAMPLE_EXACT_REMAIN){
+		estimate_tree(estimate, table, used, board, cell, remain, stride_num, SAMPLE_PROBES, (unsigned int)rng());
+	}
+
+	double weight = -1.0;
+	if (remain <= SAMPLE_EXACT_REMAIN || estimate.nodes < SAMPLE_EXACT_NODES){
+		long long budget = SAMPLE_EXACT_BUDGET;
+		weight = Exact(key, cell, remain, budget);
+	}
+	if (weight < 0.0){
+		weight = (1.0 - SAMPLE_PRIOR_RATIO) * estimate.solution_num + SAMPLE_PRIOR_RATIO * estimate.nodes * density;
+	}
+	memo[key] = weight;
+	return weight;
+}
+
+/*!
+根から葉への重み付きの降下
+
+各ノードで、子ノード(枝刈りを通る配置)を部分木の重みに比例した確率で選ぶ。
+解に着いた場合は、その解を選んだ確率の逆数を返す。(配置したピースはボードに残す)
+
+@param placed 配置したピース (基準セル, 配置表の配置番号)
+
+@return 選んだ確率の逆数 (0:解に着かなかった)
+*/
+double Sampler::Descend(vector<pair<int, int>>& placed){
+	vector<int> child;					//配置表の配置番号
+	vector<int> child_next;				//次の基準セル
+	vector<double> weight;
+	unsigned long long key = 0;
+	double inv_prob = 1.0;
+
+	int cell = 0;
+	while (board[cell] != BOARD_CELL_EMPTY){ cell++; }
+
+	for (int remain = piece_num; remain > 0; remain--){
+		call_num++;
+		child.clear();
+		child_next.clear();
+		weight.clear();
+
+		const int* current_board = &board[cell];
+		for (int n = table.start[cell]; n < table.start[cell + 1]; n++){
+			const Placement& p = table.placement[n];
+			if (used[p.piece]) { n += p.skip - 1; continue; }
+
+			bool can_place = true;
+			for (int k = 1; k < PIECE_BLOCK_NUM; k++){
+				if (current_board[p.offsets[k]] != BOARD_CELL_EMPTY) { can_place = false; break; }
+			}
+			if (!can_place) continue;
+
+			if (remain == 1){
+				child.push_back(n);
+				child_next.push_back(-1);
+				weight.push_back(1.0);
+				continue;
+			}
+
+			Place(cell, p, p.piece);
+			used[p.piece] = true;
+			int next = cell;
+			while (board[next] != BOARD_CELL_EMPTY){ next++; }
+			if (board[next + 1] == BOARD_CELL_EMPTY || board[next + stride_num] == BOARD_CELL_EMPTY){
+				const double w = Weight(key ^ Key(cell, p), next, remain - 1);
+				if (w > 0.0){
+					child.push_back(n);
+					child_next.push_back(next);
+					weight.push_back(w);
+				}
+			}
+			used[p.piece] = false;
+			Place(cell, p, BOARD_CELL_EMPTY);
+		}
+		if (child.empty()) { memo[key] = 0.0; return 0.0; }
+
+		//子ノードの重みの合計で、このノードの重みを更新する (降下する度に推定値が正確になる)
+		double total = 0.0;
+		for (double w : weight) total += w;
+		memo[key] = total;
+
+		const int c = discrete_distribution<int>(weight.begin(), weight.end())(rng);
+		inv_prob *= total / weight[c];
+
+		const Placement& p = table.placement[child[c]];
+		Place(cell, p, p.piece);
+		used[p.piece] = true;
+		placed.push_back(make_pair(cell, child[c]));
+		key ^= Key(cell, p);
+		cell = child_next[c];
+	}
+	return inv_prob;
+}
+
+/*!
+Descend で配置したピースを取り除く
+*/
+void Sampler::Restore(vector<pair<int, int>>& placed){
+	for (auto& e : placed){
+		const Placement& p = table.placement[e.second];
+		Place(e.first, p, BOARD_CELL_EMPTY);
+		used[p.piece] = false;
+	}
+	placed.clear();
+}
+
+//-----------------------------------------------------------------------------
+// public functions
+
+/*!
+ペントミノの解をランダムにサンプリングする。
+
+根から葉への降下で解を選ぶ確率をpとすると、1/p に比例する確率で受理する(棄却法)ことで、
+全ての解が等確率で選ばれるように補正する。受理の上限は、最初の SAMPLE_PILOT_ATTEMPTS 回の降下から求めた
+解の数の推定値 × SAMPLE_ACCEPT_SCALE とし、
+1/p が上限を超える解は常に受理する。(その数をclippedとして表示する。多い場合は一様からずれる)
+対称な解を除いた解の集合からサンプリングする。
+
+@param rows 配置するボードの行数
+@param cols 配置するボードの列数
+@param print_all 全ての解を表示するか?(otherwise, 最初の解のみ)
+@param swap_ij 行と列を入れ替えて探索しているか?(表示時に戻す)
+@param num サンプリングする解の数
+@param seed 乱数のseed (同じseedなら同じ解の列になる)
+
+@return サンプリングした解の数
+*/
+int sample_pentomino(int rows, int cols, const bool print_all, const bool swap_ij, const int num, const unsigned int seed){
+	assert(rows > 0);
+	assert(cols > 0);
+
+	vector<Piece> pieces;
+	{
+		PhaseTimer phase(PROFILE_INIT_PIECES);
+		init_pieces(pieces, rows, cols);
+	}
+	const int piece_num = (int)pieces.size();
+
+	//自明な条件の削除
+	if (piece_num*PIECE_BLOCK_NUM > (rows*cols)) return 0;
+
+	vector<int> board;
+	PlacementTable table;
+	{
+		PhaseTimer phase(PROFILE_BOARD_SETUP);
+		board = create_board(rows, cols);
+		build_placement_table(table, pieces, board);
+	}
+
+	Sampler sampler(table, board, piece_num, cols + 1, seed);
+	uniform_real_distribution<double> uniform(0.0, 1.0);
+
+	int sample_num = 0;
+	long long attempt_num = 0;
+	int clipped_num = 0;
+	double bound = 0.0;
+	double setup_ms = 0.0, sample_ms = 0.0;
+	long long setup_call_num = 0;
+	{
+		Timer tmr("process time:\t");
+		PhaseTimer phase(PROFILE_SEARCH);		//解の表示を含む
+		PerfCounter counter;
+		counter.Start();
+		SolutionWriter writer(pieces, rows, cols, swap_ij);
+
+		const auto t0 = chrono::steady_clock::now();
+		int cell = 0;
+		while (board[cell] != BOARD_CELL_EMPTY){ cell++; }
+		sampler.Init(cell);
+
+		//受理の上限 (降下で選ぶ確率の逆数の平均は、解の数の不偏推定値)
+		vector<pair<int, int>> placed;
+		double sum = 0.0;
+		for (int attempt = 0; attempt < SAMPLE_PILOT_ATTEMPTS; attempt++){
+			sum += sampler.Descend(placed);
+			sampler.Restore(placed);
+		}
+		bound = max(sum / SAMPLE_PILOT_ATTEMPTS, 1.0) * SAMPLE_ACCEPT_SCALE;
+		const auto t1 = chrono::steady_clock::now();
+		setup_ms = chrono::duration<double, milli>(t1 - t0).count();
+		setup_call_num = sampler.call_num;
+
+		//試行の上限 (num が大きくても溢れないよう long long で数える)
+		const long long max_attempt_num = (long long)SAMPLE_MAX_ATTEMPTS * num;
+		while (sample_num < num && attempt_num < max_attempt_num){
+			attempt_num++;
+			const double inv_prob = sampler.Descend(placed);
+
+			bool accept = false;
+			if (inv_prob > 0.0){
+				if (inv_prob > bound) { accept = true; clipped_num++; }
+				else accept = uniform(sampler.rng) * bound < inv_prob;
+			}
+			if (accept){
+				sample_num++;
+				if (print_all || sample_num == 1) writer.Write(board, sample_num);
+			}
+
+			sampler.Restore(placed);
+		}
+		counter.Stop();
+		profile_add_thread(0, counter, sampler.call_num);
+		sample_ms = chrono::duration<double, milli>(chrono::steady_clock::now() - t1).count();
+	}
+	g_find_solution_call_num += sampler.call_num;
+
+	printf("sample attempts:%lld\taccepted:%d\tclipped:%d\tbound:%.1f\tmemo:%d\n", attempt_num, sample_num, clipped_num, bound, (int)sampler.memo.size());
+	printf("sample setup:%.1f[ms] (%lld nodes)\tsampling:%.1f[ms] (%lld nodes)\tper sample:%.3f[ms] (%.0f nodes)\n",
+		setup_ms, setup_call_num, sample_ms, sampler.call_num - setup_call_num,
+		sample_num > 0 ? sample_ms / sample_num : 0.0, sample_num > 0 ? (double)(sampler.call_num - setup_call_num) / sample_num : 0.0);
+	return sample_num;
+}
@@ -0,0 +1,487 @@
+﻿/*
+Copyright (c) 2016, oasi-adamay
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+* Neither the name of glsCV nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*!
+@file	server.cpp
+@author	oasi-adamay
+@brief	パズルの補完サーバ。標準入力またはUnixドメインソケットで要求を受け、解(補完)を返す。
+
+要求 (1行1要求)
+	rows cols mode [board]
+	- mode	first:解を一つ  all:全ての解  count:解の数のみ  N:最大N個の解
+	- board	rows行を'/'で区切った盤面 ('.':空き '#':穴 'X':ピースXが覆うセル)
+			ピースの5セル全てを指定した場合は、配置済みとして扱う。
+	stats	レイテンシの統計を返す
+	quit	接続を閉じる
+
+ソケットのサーバは SIGINT/SIGTERM で接続を閉じて終了し、レイテンシの統計を表示する。
+
+応答
+	= solution_num:n call_num:k time:t[us]
+	解 (compact形式、1行1解)
+	.
+	エラーの場合は "! message"
+
+ピースデータと配置表はボードサイズ毎に一度だけ生成し、以降の要求で使い回す。
+*/
+
+//-----------------------------------------------------------------------------
+// generic include
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <deque>
+#include <memory>
+#include <sstream>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <poll.h>
+#include <signal.h>
+#include <errno.h>
+#endif
+
+#include "pentomino.h"
+#include "pentomino_internal.h"
+
+using namespace std;
+
+/*!
+const & define macro
+*/
+#define SERVER_CELL_MAX			4096		//max number of cells of the board
+#define SERVER_POLL_MS			200			//interval to check the shutdown request [ms]
+#define SERVER_BACKOFF_MS		100			//wait after accept fails for lack of resources [ms]
+#define LATENCY_BUCKET_PER_OCTAVE	8		//latency histogram buckets per doubling (about 9% resolution)
+#define LATENCY_BUCKET_NUM		(LATENCY_BUCKET_PER_OCTAVE * 40)	//latency histogram buckets (1[us] .. 2^40[us])
+
+//-----------------------------------------------------------------------------
+
+/*!
+ボードサイズ毎の探索データ (生成後は読み出し専用なので、スレッド間で共有する)
+*/
+struct WarmBoard {
+	vector<Piece>	pieces;		//!< ペントミノデータ (冗長な形状を削除していない)
+	PlacementTable	table;		//!< 空のボードの配置表
+};
+
+/*!
+探索データのキャッシュ
+*/
+class WarmCache {
+private:
+	mutex mtx;
+	map<pair<int, int>, shared_ptr<const WarmBoard>> cache;
+public:
+	shared_ptr<const WarmBoard> Get(const int rows, const int cols){
+		lock_guard<mutex> lock(mtx);
+		auto& entry = cache[make_pair(rows, cols)];
+		if (!entry) {
+			shared_ptr<WarmBoard> warm = make_shared<WarmBoard>();
+			init_pieces(warm->pieces, rows, cols, false);
+			build_placement_table(warm->table, warm->pieces, create_board(rows, cols));
+			entry = warm;
+		}
+		return entry;
+	}
+};
+
+/*!
+レイテンシの統計
+
+長時間動くサーバでもメモリと集計の時間が増えないよう、対数の幅のヒストグラムに数える。
+p50/p99 はバケットの上端 (LATENCY_BUCKET_PER_OCTAVE で決まる精度の近似値)、max は実測値。
+*/
+class LatencyStats {
+private:
+	mutex mtx;
+	long long count[LATENCY_BUCKET_NUM];	//!< バケット毎の要求の数
+	long long total;						//!< 要求の数
+	double max_us;							//!< 最大値 [us]
+
+	static int Bucket(const double us){
+		if (us <= 1.0) return 0;
+		const int b = (int)ceil(log2(us) * LATENCY_BUCKET_PER_OCTAVE);
+		return min(b, LATENCY_BUCKET_NUM - 1);
+	}
+	static double Upper(const int b){ return exp2((double)b / LATENCY_BUCKET_PER_OCTAVE); }	//!< バケットの上端 [us]
+
+	//! 全体の割合 q 以下の要求が収まるバケットの上端 (要ロック)
+	double Quantile(const double q) const {
+		const long long rank = max(1LL, (long long)ceil(total * q));
+		long long sum = 0;
+		for (int b = 0; b < LATENCY_BUCKET_NUM; b++) {
+			sum += count[b];
+			if (sum >= rank) return min(Upper(b), max_us);
+		}
+		return max_us;
+	}
+public:
+	LatencyStats(void) : total(0), max_us(0) { memset(count, 0, sizeof(count)); }
+
+	void Add(const double us){
+		lock_guard<mutex> lock(mtx);
+		count[Bucket(us)]++;
+		total++;
+		max_us = max(max_us, us);
+	}
+	string Report(void){
+		lock_guard<mutex> lock(mtx);
+		char buf[128];
+		if (total == 0) {
+			snprintf(buf, sizeof(buf), "requests:0");
+		}
+		else {
+			snprintf(buf, sizeof(buf), "requests:%lld p50:%.1f[us] p99:%.1f[us] max:%.1f[us]",
+				total, Quantile(0.50), Quantile(0.99), max_us);
+		}
+		return buf;
+	}
+};
+
+//-----------------------------------------------------------------------------
+// private functions
+
+/*!
+要求の処理
+
+@return 応答
+*/
+static string handle_request(const string& line, WarmCache& cache, LatencyStats& stats){
+	const auto t0 = chrono::steady_clock::now();
+
+	istringstream is(line);
+	int rows = 0, cols = 0;
+	string mode, text;
+	is >> rows >> cols >> mode >> text;
+
+	if (rows < 1 || cols < 1 || rows > SERVER_CELL_MAX / cols || mode.empty()) return "! invalid request\n";
+
+	int limit;
+	int keep_num;
+	if (mode == "first") { limit = 1; keep_num = 1; }
+	else if (mode == "all") { limit = INT_MAX; keep_num = INT_MAX; }
+	else if (mode == "count") { limit = INT_MAX; keep_num = 0; }
+	else if (atoi(mode.c_str()) > 0) { limit = atoi(mode.c_str()); keep_num = limit; }
+	else return "! invalid mode\n";
+
+	//盤面 -> 配置条件 (表示の行列で指定する)
+	string spec;
+	if (!text.empty()) {
+		int r = 0, c = 0;
+		for (char ch : text) {
+			if (ch == '/') { r++; c = 0; continue; }
+			if (r >= rows || c >= cols) return "! invalid board\n";
+			if (ch != '.') {
+				if (!spec.empty()) spec += ',';
+				spec += ch;
+				spec += ":" + to_string(r) + ":" + to_string(c);
+			}
+			c++;
+		}
+	}
+
+	//探索方向が横方向の為、縦長のboardの方が、効率よく枝狩り出来る。
+	const bool swap_ij = cols > rows;
+	if (swap_ij) swap(rows, cols);
+
+	shared_ptr<const WarmBoard> warm = cache.Get(rows, cols);
+
+	ConstraintProblem prob;
+	if (!setup_constraint_problem(prob, warm->pieces, &warm->table, rows, cols, swap_ij, spec.c_str())) return "! invalid board\n";
+
+	SolutionList solution(keep_num, NULL, limit);
+	long long call_num = 0;
+	solve_constraint_problem(prob, solution, limit > 1, cols + 1, call_num);
+
+	SolutionWriter writer(warm->pieces, rows, cols, swap_ij, PRINT_FORMAT_COMPACT, NULL);
+	for (auto& board : solution.solution) writer.Write(board, 0);
+
+	const double us = chrono::duration<double, micro>(chrono::steady_clock::now() - t0).count();
+	stats.Add(us);
+
+	char head[128];
+	snprintf(head, sizeof(head), "= solution_num:%d call_num:%lld time:%.1f[us]\n", solution.num, call_num, us);
+	return head + writer.Str() + ".\n";
+}
+
+/*!
+要求の振り分け (stats / 探索)
+*/
+static string dispatch(const string& line, WarmCache& cache, LatencyStats& stats){
+	if (line == "stats") return "= " + stats.Report() + "\n.\n";
+	return handle_request(line, cache, stats);
+}
+
+/*!
+標準入力から要求を受ける
+
+要求はスレッドプールで並列に処理し、応答の先頭には要求の番号(1 origin)を付ける。
+*/
+static void serve_stdin(const int thread_num, WarmCache& cache, LatencyStats& stats){
+	mutex mtx;
+	mutex out_mtx;
+	condition_variable cv;
+	deque<pair<int, string>> queue;
+	bool eof = false;
+
+	auto worker = [&]() {
+		for (;;) {
+			pair<int, string> req;
+			{
+				unique_lock<mutex> lock(mtx);
+				cv.wait(lock, [&]{ return !queue.empty() || eof; });
+				if (queue.empty()) return;
+				req = queue.front();
+				queue.pop_front();
+			}
+			const string res = dispatch(req.second, cache, stats);
+			lock_guard<mutex> lock(out_mtx);
+			printf("#%d %s", req.first, res.c_str());
+			fflush(stdout);
+		}
+	};
+
+	vector<thread> threads;
+	for (int i = 0; i < thread_num; i++) threads.push_back(thread(worker));
+
+	char buf[8192];
+	int no = 0;
+	while (fgets(buf, sizeof(buf), stdin)) {
+		string line(buf);
+		while (!line.empty() && (line.back() == '\n' || line.back() == '\r')) line.pop_back();
+		if (line.empty()) continue;
+		if (line == "quit") break;
+		{
+			lock_guard<mutex> lock(mtx);
+			queue.push_back(make_pair(++no, line));
+		}
+		cv.notify_one();
+	}
+	{
+		lock_guard<mutex> lock(mtx);
+		eof = true;
+	}
+	cv.notify_all();
+	for (auto& th : threads) th.join();
+}
+
+#ifndef _WIN32
+static volatile sig_atomic_t s_shutdown = 0;	//!< SIGINT/SIGTERM を受けたか?
+
+static void shutdown_handler(int){
+	s_shutdown = 1;
+}
+
+/*!
+接続中のソケット (終了時に全ての接続を閉じて、接続毎のスレッドの終了を待つ)
+*/
+class ConnectionList {
+private:
+	mutex mtx;
+	condition_variable cv;
+	vector<int> fds;
+public:
+	void Add(const int fd){
+		lock_guard<mutex> lock(mtx);
+		fds.push_back(fd);
+	}
+
+	//接続を閉じる (fdの再利用と Shutdown が競合しないよう、ロックの中で閉じる)
+	void Close(const int fd){
+		lock_guard<mutex> lock(mtx);
+		fds.erase(std::remove(fds.begin(), fds.end(), fd), fds.end());
+		close(fd);
+		cv.notify_all();
+	}
+
+	//全ての接続の受信を止め、接続毎のスレッドが終わるのを待つ
+	void Shutdown(void){
+		unique_lock<mutex> lock(mtx);
+		for (int fd : fds) shutdown(fd, SHUT_RDWR);
+		cv.wait(lock, [&]{ return fds.empty(); });
+	}
+};
+
+/*!
+ソケットの接続毎の処理 (要求は順に処理する)
+*/
+static void serve_connection(const int fd, WarmCache& cache, LatencyStats& stats, ConnectionList& conns){
+	string pending;
+	char buf[4096];
+	for (;;) {
+		const ssize_t n = recv(fd, buf, sizeof(buf), 0);
+		if (n <= 0) break;
+		pending.append(buf, n);
+
+		size_t pos;
+		while ((pos = pending.find('\n')) != string::npos) {
+			string line = pending.substr(0, pos);
+			pending.erase(0, pos + 1);
+			if (!line.empty() && line.back() == '\r') line.pop_back();
+			if (line.empty()) continue;
+			if (line == "quit") { conns.Close(fd); return; }
+
+			const string res = dispatch(line, cache, stats);
+			size_t sent = 0;
+			while (sent < res.size()) {
+				const ssize_t m = send(fd, res.data() + sent, res.size() - sent, MSG_NOSIGNAL);
+				if (m <= 0) { conns.Close(fd); return; }
+				sent += m;
+			}
+		}
+	}
+	conns.Close(fd);
+}
+
+/*!
+Unixドメインソケットで要求を受ける (接続毎にスレッドを起こす)
+
+SIGINT/SIGTERM を受けるまで接続を受け付ける。
+accept が資源不足(EMFILEなど)で失敗した場合は少し待ってから再び受け付け、それ以外のエラーでは終了する。
+*/
+static bool serve_socket(const char* path, WarmCache& cache, LatencyStats& stats){
+	const int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (sock < 0) return false;
+
+	struct sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if (strlen(path) >= sizeof(addr.sun_path)) { close(sock); return false; }
+	strcpy(addr.sun_path, path);
+	unlink(path);
+
+	if (bind(sock, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(sock, 64) < 0) {
+		close(sock);
+		return false;
+	}
+	fprintf(stderr, "listening on %s\n", path);
+
+	//終了の要求はシグナルハンドラで受け、acceptの前にpollで確かめる (どのスレッドがシグナルを受けてもよい)
+	struct sigaction sa, old_int, old_term;
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = shutdown_handler;
+	sigemptyset(&sa.sa_mask);
+	s_shutdown = 0;
+	sigaction(SIGINT, &sa, &old_int);
+	sigaction(SIGTERM, &sa, &old_term);
+
+	ConnectionList conns;
+	while (!s_shutdown) {
+		struct pollfd pfd = { sock, POLLIN, 0 };
+		const int ready = poll(&pfd, 1, SERVER_POLL_MS);
+		if (ready <= 0) {
+			if (ready < 0 && errno != EINTR) { perror("poll"); break; }
+			continue;
+		}
+
+		const int fd = accept(sock, NULL, NULL);
+		if (fd < 0) {
+			if (errno == EINTR || errno == ECONNABORTED || errno == EAGAIN) continue;
+			if (errno == EMFILE || errno == ENFILE || errno == ENOBUFS || errno == ENOMEM) {
+				this_thread::sleep_for(chrono::milliseconds(SERVER_BACKOFF_MS));
+				continue;
+			}
+			perror("accept");
+			break;
+		}
+		conns.Add(fd);
+		thread(serve_connection, fd, ref(cache), ref(stats), ref(conns)).detach();
+	}
+
+	close(sock);
+	unlink(path);
+	conns.Shutdown();
+
+	sigaction(SIGINT, &old_int, NULL);
+	sigaction(SIGTERM, &old_term, NULL);
+	return true;
+}
+#endif
+
+//-----------------------------------------------------------------------------
+// public functions
+
+/*!
+補完サーバ
+
+@param socket_path Unixドメインソケットのパス (NULL:標準入力から要求を受ける)
+@param thread_num 標準入力の要求を処理するスレッド数 (0:コア数)
+
+@return 0:正常終了
+*/
+int serve_pentomino(const char* socket_path, int thread_num){
+	if (thread_num <= 0) thread_num = (int)thread::hardware_concurrency();
+	if (thread_num <= 0) thread_num = 1;
+
+	WarmCache cache;
+	LatencyStats stats;
+
+	if (socket_path) {
+#ifdef _WIN32
+		fprintf(stderr, "unix domain socket is not supported.\n");
+		return -1;
+#else
+		if (!serve_socket(socket_path, cache, stats)) {
+			fprintf(stderr, "can not listen on %s\n", socket_path);
+			return -1;
+		}
+#endif
+	}
+	else {
+		serve_stdin(thread_num, cache, stats);
+	}
+
+	fprintf(stderr, "latency %s\n", stats.Report().c_str());
+	return 0;
+}
+
+/*!
+要求を一つ処理する (キャッシュを使わない, テスト用)
+
+@param line 要求 (書式は handle_request を参照)
+
+@return 応答
+*/
+string serve_request(const string& line){
+	WarmCache cache;
+	LatencyStats stats;
+	return dispatch(line, cache, stats);
+}
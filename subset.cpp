@@ -0,0 +1,314 @@
+﻿/*
+Copyright (c) 2016, oasi-adamay
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+* Neither the name of glsCV nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*!
+@file	subset.cpp
+@author	oasi-adamay
+@brief	在庫からピースを選んでボードを埋める探索。(ピースの一部だけを使う、同じピースを複数使う)
+
+在庫の書式 "n|Xn[,...]"
+- n   全てのピースを n 個まで使える
+- Xn  ピースXを n 個まで使える (0:使わない)
+ボードの面積/5 個のピースで、ボードをちょうど埋める。
+使うピースの組を探索の外で列挙せず、ピース毎の残りの数を探索の状態として持つ。
+
+使うピースの組によって冗長な形状の削除(remove_redundant_shape)は正しくないので行わない。
+(回転・鏡像による解も別の解として数える)
+*/
+
+//-----------------------------------------------------------------------------
+// generic include
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <assert.h>
+
+#include "pentomino.h"
+#include "pentomino_internal.h"
+
+using namespace std;
+
+/*!
+const & define macro
+*/
+#define SUBSET_COPY_MAX		64		//max number of copies of a piece
+
+//-----------------------------------------------------------------------------
+
+/*!
+探索の状態
+*/
+struct SubsetSearch {
+	const PlacementTable&	table;
+	vector<int>&			board;
+	vector<int>				count;		//!< ピース毎の残りの数
+	const int				stride_num;
+	vector<int>				mark;		//!< 空き領域の探索済みの印 (stamp と等しければ探索済み)
+	int						stamp;
+	vector<int>				stack;		//!< 空き領域の探索の作業領域
+	long long				call_num;
+
+	SubsetSearch(const PlacementTable& _table, vector<int>& _board, const vector<int>& _count, const int _stride_num)
+		: table(_table), board(_board), count(_count), stride_num(_stride_num), mark(_board.size(), 0), stamp(0), call_num(0) {}
+};
+
+//-----------------------------------------------------------------------------
+// private functions
+
+/*!
+在庫の解析
+
+@param count ピース毎に使える数
+@return false:書式エラー
+*/
+static bool parse_inventory(const char* spec, const vector<Piece>& pieces, vector<int>& count){
+	const int n = (int)pieces.size();
+	count.assign(n, 1);
+
+	string f(spec);
+	size_t pos = 0;
+	while (pos < f.size()) {
+		size_t end = f.find(',', pos);
+		if (end == string::npos) end = f.size();
+		string item = f.substr(pos, end - pos);
+		pos = end + 1;
+		if (item.empty()) return false;
+
+		int i = -1;		//-1:全てのピース
+		const char* num = item.c_str();
+		if (!isdigit((unsigned char)num[0])) {
+			i = 0;
+			while (i < n && pieces[i].name != num[0]) i++;
+			if (i == n) return false;
+			num++;
+		}
+
+		char* num_end;
+		const long c = *num ? strtol(num, &num_end, 10) : 1;
+		if (*num && *num_end) return false;
+		if (c < 0 || c > SUBSET_COPY_MAX) return false;
+
+		if (i < 0) count.assign(n, (int)c);
+		else count[i] = (int)c;
+	}
+	return true;
+}
+
+/*!
+ピースを置いた後の空き領域の大きさのチェック
+
+置いたピースに隣接する空き領域の大きさ(セルの数)が5の倍数でなければ、その領域は埋められない。
+(ピースに隣接しない空き領域は、前のノードでチェック済み)
+
+@param cell 置いたピースの基準セル
+@param offsets 置いたピースのブロックの位置
+@return false:埋められない空き領域がある
+*/
+static bool check_empty_regions(SubsetSearch& s, const int cell, const int* offsets){
+	const int stride_num = s.stride_num;
+	const int size = (int)s.board.size();
+	const int dir[4] = { 1, -1, stride_num, -stride_num };
+	s.stamp++;
+
+	for (int k = 0; k < PIECE_BLOCK_NUM; k++){
+		for (int d = 0; d < 4; d++){
+			const int start = cell + offsets[k] + dir[d];
+			if (start < 0 || start >= size) continue;
+			if (s.board[start] != BOARD_CELL_EMPTY || s.mark[start] == s.stamp) continue;
+
+			//空き領域の大きさを数える
+			int area = 0;
+			s.stack.clear();
+			s.stack.push_back(start);
+			s.mark[start] = s.stamp;
+			while (!s.stack.empty()){
+				const int c = s.stack.back();
+				s.stack.pop_back();
+				area++;
+				for (int d2 = 0; d2 < 4; d2++){
+					const int n = c + dir[d2];
+					if (n < 0 || n >= size) continue;
+					if (s.board[n] != BOARD_CELL_EMPTY || s.mark[n] == s.stamp) continue;
+					s.mark[n] = s.stamp;
+					s.stack.push_back(n);
+				}
+			}
+			if (area % PIECE_BLOCK_NUM) return false;
+		}
+	}
+	return true;
+}
+
+/*!
+最初の空きセルを覆う配置の探索 (find_solution_table と同じ探索順)
+
+残りの数が0のピースの配置は飛ばす。
+ボードの空きセルの数は、常に配置するピースの数 x 5 に等しい。
+
+@param s			探索の状態
+@param cell			最初の空きセル
+@param remain		配置するピースの数
+@param solution		解のリスト
+@param find_all		全ての解を見つけるか?
+
+@retuen ture:探索を終了した (!find_all で解を見つけた、または solution.Done())
+	終了する場合も、ボードとピースの残りの数は呼び出し前に戻す。
+*/
+static bool find_subset_solution(SubsetSearch& s, int cell, const int remain, SolutionSink& solution, const bool find_all){
+	s.call_num++;
+
+	int* board_base = &s.board[0];
+	int* current_board = board_base + cell;
+	const Placement* p = s.table.placement.data() + s.table.start[cell];
+	const Placement* end = s.table.placement.data() + s.table.start[cell + 1];
+
+	for (; p != end; ++p){
+		const int i = p->piece;
+		if (s.count[i] == 0) { p += p->skip - 1; continue; }		//使い切ったピースの配置を飛ばす
+
+		const int* offset = p->offsets;
+
+		//ピースが置けるかチェックする。
+		{
+			bool can_place = true;
+			for (int k = 1; k<PIECE_BLOCK_NUM; k++){		//k=0は自明
+				if (current_board[offset[k]] != BOARD_CELL_EMPTY) { can_place = false;  break; }
+			}
+			if (!can_place)	continue;
+		}
+
+		{	//更新　（ここでの操作は、下の修復と対になる)
+			for (int k = 0; k<PIECE_BLOCK_NUM; k++){ current_board[offset[k]] = i; }
+			s.count[i]--;
+		}
+
+		bool done = false;
+		if (remain == 1){
+			solution.Push(s.board);
+			done = !find_all || solution.Done();
+		}
+		else if (check_empty_regions(s, cell, offset)){
+			int next = cell;
+			while (board_base[next] != BOARD_CELL_EMPTY){ next++; }
+			done = find_subset_solution(s, next, remain - 1, solution, find_all);
+		}
+
+		{	//修復　restore (探索を終了する場合も戻す)
+			for (int k = 0; k<PIECE_BLOCK_NUM; k++){ current_board[offset[k]] = BOARD_CELL_EMPTY; }
+			s.count[i]++;
+		}
+		if (done) return true;
+	}
+	return false;
+}
+
+//-----------------------------------------------------------------------------
+// public functions
+
+/*!
+在庫からピースを選んでボードを埋める。
+
+@param rows 配置するボードの行数
+@param cols 配置するボードの列数
+@param find_all 全ての解を見つけるか?
+@param print_all 全ての解を表示するか?
+@param swap_ij 行と列を入れ替えて探索しているか?(表示時に戻す)
+@param spec 在庫 "n|Xn[,...]"
+
+@return 解の数 (-1:在庫の書式エラー)
+*/
+int solve_pentomino_subset(int rows, int cols, const bool find_all, const bool print_all, const bool swap_ij, const char* spec){
+	assert(rows > 0);
+	assert(cols > 0);
+
+	vector<Piece> pieces;
+	{
+		PhaseTimer phase(PROFILE_INIT_PIECES);
+		init_pieces(pieces, rows, cols, false);
+	}
+	const int piece_num = (int)pieces.size();
+
+	vector<int> count;
+	if (!parse_inventory(spec, pieces, count)) {
+		printf("invalid inventory: %s\n", spec);
+		return -1;
+	}
+
+	//ボードを埋めるピースの数
+	const int remain = rows * cols / PIECE_BLOCK_NUM;
+	int stock = 0;
+	printf("inventory:");
+	for (int i = 0; i < piece_num; i++){
+		printf(" %c:%d", pieces[i].name, count[i]);
+		stock += count[i];
+	}
+	printf("\tpiece_num:%d\n", remain);
+
+	//自明な条件の削除
+	if (rows * cols % PIECE_BLOCK_NUM) return 0;
+	if (stock < remain) return 0;
+
+	SolutionList solution(print_all ? INT_MAX : 1, NULL, find_all ? INT_MAX : 1);
+	{
+		Timer tmr("process time:\t");
+
+		vector<int> board;
+		PlacementTable table;
+		{
+			PhaseTimer phase(PROFILE_BOARD_SETUP);
+			board = create_board(rows, cols);
+			build_placement_table(table, pieces, board);
+		}
+
+		PhaseTimer phase(PROFILE_SEARCH);
+		PerfCounter counter;
+		SubsetSearch s(table, board, count, cols + 1);
+		counter.Start();
+		find_subset_solution(s, 0, remain, solution, find_all);
+		counter.Stop();
+		profile_add_thread(0, counter, s.call_num);
+		g_find_solution_call_num += s.call_num;
+	}
+
+	{	//解の表示
+		PhaseTimer phase(PROFILE_OUTPUT);
+		SolutionWriter writer(pieces, rows, cols, swap_ij);
+		int i = 0;
+		for (auto itr = solution.solution.begin(); itr != solution.solution.end(); ++itr, i++) {
+			writer.Write(*itr, i + 1);
+		}
+	}
+
+	return find_all ? solution.num : min(solution.num, 1);
+}
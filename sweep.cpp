@@ -0,0 +1,710 @@
+﻿/*
+Copyright (c) 2016, oasi-adamay
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+* Neither the name of glsCV nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*!
+@file	sweep.cpp
+@author	oasi-adamay
+@brief	ボードの族の一括探索。(指定した面積の全ての長方形、穴のあるボード)
+
+面積 A のボードは、行数 x 列数 = A の長方形 (行数 >= 列数、swap_ij の向き) に、A - 60 個の穴を任意の位置に開けたもの。
+列数の等しいボードは、最も行数の多いボード(最も背の高いボード)の探索を共有する。
+- 探索は、最初の空きセルをピースで覆うか、穴にするかを選ぶ。(穴の位置の組毎に探索をやり直さない)
+  穴の位置が異なるボードでも、最初の穴より前のセルで共通する部分木は一度だけ探索する。
+- 背の低いボードは、背の高いボードの下の行を全て穴にしたもの。
+- 配置表と冗長な形状の削除は、列数毎に一つだけ作って使い回す。
+- 穴が残っていないノードの部分木の解の数は、置換表に記録して使い回す。(SweepMemo)
+列数毎の探索(ジョブ)は、探索ノード数の推定値の大きい順にスレッドに割り当てる。
+*/
+
+//-----------------------------------------------------------------------------
+// generic include
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <climits>
+#include <string>
+#include <vector>
+#include <set>
+#include <random>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <assert.h>
+
+#include "pentomino.h"
+#include "pentomino_internal.h"
+
+using namespace std;
+
+/*!
+const & define macro
+*/
+#define SWEEP_PROBES		4096		//number of probes to estimate the nodes of a job
+#define SWEEP_HOLE_MAX		16		//max number of holes of a board
+#define SWEEP_MEMO_BITS		20		//log2 of the number of entries of the transposition table of a job
+#define SWEEP_MEMO_REMAIN_MIN	4		//min number of pieces left to look up the transposition table
+
+//-----------------------------------------------------------------------------
+
+/*!
+族のボード (ジョブの背の高いボードの上の rows 行)
+*/
+struct SweepBoard {
+	int					area;		//!< ボードの面積
+	int					rows;		//!< 行数
+	int					holes;		//!< 穴の数
+	long long			num;		//!< 解の数 (冗長な形状の削除後)
+	set<vector<int>>	masks;		//!< 解のある穴の位置の組
+};
+
+/*!
+ジョブ (列数の等しいボードの探索)
+*/
+struct SweepJob {
+	int					cols;		//!< 列数
+	int					rows;		//!< 最も背の高いボードの行数
+	int					holes;		//!< 最も背の高いボードの穴の数
+	vector<SweepBoard>	boards;		//!< 族のボード
+	bool				feasible;	//!< false:置けないピースがある (探索しない)
+	double				estimate;	//!< 探索ノード数の推定値
+	long long			call_num;	//!< 探索ノード数
+	long long			memo_hit;	//!< 置換表で探索を省いたノードの数
+	double				sec;		//!< 探索時間
+};
+
+/*!
+置換表のエントリ (穴が残っていないノードの部分木の解の数)
+
+最初の空きセル以降で埋まっているセルは、それより前のセルを基準セルとするピースのブロックだけなので、
+最初の空きセルから配置の最大のオフセットまでのセル(フロンティア)に限られる。
+穴が残っていなければ部分木の解は全て同じ穴の位置の組になるので、
+(最初の空きセル, フロンティアの占有状態, 使用済みのピース) が等しいノードの部分木の解の数は等しい。
+穴が残っているノードは、部分木の解毎に穴の位置が異なり、ボード毎の解の数と穴の位置の組を記録する必要があるので表を引かない。
+*/
+struct SweepMemo {
+	unsigned long long	frontier;	//!< フロンティアの占有状態 (bit k: 最初の空きセル + 1 + k)
+	unsigned int		key;		//!< 1 | 最初の空きセル << 1 | 使用済みのピース << 9 (0:空きエントリ)
+	long long			num;		//!< 部分木の解の数
+};
+
+/*!
+探索の状態
+*/
+struct SweepSearch {
+	SweepJob&				job;
+	const PlacementTable&	table;
+	vector<int>				board;
+	vector<bool>			used;
+	vector<int>				hole;		//!< 穴にしたセル
+	const int				stride_num;
+	vector<int>				mark;		//!< 空き領域の探索済みの印 (stamp と等しければ探索済み)
+	int						stamp;
+	vector<int>				stack;		//!< 空き領域の探索の作業領域
+	long long				call_num;
+	unsigned int			used_bits;		//!< 使用済みのピース (bit i: ピース i)
+	int						frontier_len;	//!< フロンティアのセルの数 (配置の最大のオフセット)
+	long long				found;			//!< 記録した解の数
+	vector<SweepMemo>		memo;			//!< 置換表 (フロンティアが64セル、ボードが256セルを超える場合は空)
+	long long				memo_hit;		//!< 置換表で探索を省いたノードの数
+
+	SweepSearch(SweepJob& _job, const PlacementTable& _table, const vector<int>& _board, const int piece_num)
+		: job(_job), table(_table), board(_board), used(piece_num, false), stride_num(_job.cols + 1), mark(_board.size(), 0), stamp(0), call_num(0),
+		used_bits(0), frontier_len(0), found(0), memo_hit(0)
+	{
+		for (const auto& p : table.placement){
+			for (int k = 0; k < PIECE_BLOCK_NUM; k++) frontier_len = max(frontier_len, p.offsets[k]);
+		}
+	}
+};
+
+//-----------------------------------------------------------------------------
+// private functions
+
+/*!
+解の記録
+
+全てのピースを置いた時点の空きセルも穴にする。
+下の行が全て穴になっているボード毎に、解の数と穴の位置の組を記録する。
+
+@param cell 穴にする空きセルを探し始めるセル (ボードの大きさ:置換表の解、穴の位置の組は s.hole のみ)
+@param num 解の数
+*/
+static void record_sweep_solution(SweepSearch& s, const int cell, const long long num = 1){
+	vector<int> mask = s.hole;
+	for (int c = cell; c < (int)s.board.size(); c++){
+		if (s.board[c] == BOARD_CELL_EMPTY) mask.push_back(c);
+	}
+	s.found += num;
+
+	for (auto& b : s.job.boards){
+		//rows 行目以降の穴の数 (rows 行目以降のセルが全て穴か?)
+		const int below = (s.job.rows - b.rows) * s.job.cols;
+		const int first = b.rows * s.stride_num;
+		const int n = (int)(mask.end() - lower_bound(mask.begin(), mask.end(), first));
+		if (n != below) continue;
+
+		b.num += num;
+		b.masks.insert(vector<int>(mask.begin(), mask.end() - n));
+	}
+}
+
+/*!
+空き領域に必要な穴の数
+
+空き領域毎に、大きさ(セルの数)を5で割った余りのセルは穴にするしかない。
+その合計が残りの穴の数を超えれば、ボードは埋められない。
+ボード全体の空き領域を調べるので、根と穴にした直後のノードだけで使い、それ以外は置いたピースに隣接する空き領域だけを調べて更新する。(update_required_holes)
+穴が残っていない場合は最初の空きセルが孤立しているかだけを調べる。(find_solution_table と同じ)
+
+@param cell 最初の空きセル (これより前のセルは全て埋まっている)
+*/
+static int count_required_holes(SweepSearch& s, const int cell){
+	const int stride_num = s.stride_num;
+	const int size = (int)s.board.size();
+	const int dir[4] = { 1, -1, stride_num, -stride_num };
+	s.stamp++;
+
+	int required = 0;
+	for (int start = cell; start < size; start++){
+		if (s.board[start] != BOARD_CELL_EMPTY || s.mark[start] == s.stamp) continue;
+
+		int area = 0;
+		s.stack.clear();
+		s.stack.push_back(start);
+		s.mark[start] = s.stamp;
+		while (!s.stack.empty()){
+			const int c = s.stack.back();
+			s.stack.pop_back();
+			area++;
+			for (int d = 0; d < 4; d++){
+				const int n = c + dir[d];
+				if (n < cell || n >= size) continue;
+				if (s.board[n] != BOARD_CELL_EMPTY || s.mark[n] == s.stamp) continue;
+				s.mark[n] = s.stamp;
+				s.stack.push_back(n);
+			}
+		}
+		required += area % PIECE_BLOCK_NUM;
+	}
+	return required;
+}
+
+/*!
+ピースを置いた後の空き領域に必要な穴の数の更新 (subset.cpp の check_empty_regions と同じく、置いたピースに隣接する空き領域だけを調べる)
+
+ピースは最初の空きセルを含む空き領域 R の中に置かれ、R の残りは全てピースに隣接する空き領域 C に分かれる。
+それ以外の空き領域は変わらないので、必要な穴の数は R の分を C の分に置き換えたものになる。(|R| = ΣC + 5)
+穴にする手でも同じく更新すると、穴毎に空き領域を調べることになり、全体を数え直すより調べるセルが増えたので(3x21: 332M -> 336M)、
+穴にした直後のノードは count_required_holes で数え直す。(3x21: 266M)
+
+@param required 親ノードの必要な穴の数
+@param cell 置いたピースの基準セル
+@param offsets 置いたピースのブロックの位置
+@return 子ノードの必要な穴の数
+*/
+static int update_required_holes(SweepSearch& s, const int required, const int cell, const int* offsets){
+	const int stride_num = s.stride_num;
+	const int size = (int)s.board.size();
+	const int dir[4] = { 1, -1, stride_num, -stride_num };
+	s.stamp++;
+
+	int total = 0;		//ΣC
+	int rest = 0;		//Σ(C % 5)
+	for (int k = 0; k < PIECE_BLOCK_NUM; k++){
+		for (int d = 0; d < 4; d++){
+			const int start = cell + offsets[k] + dir[d];
+			if (start < 0 || start >= size) continue;
+			if (s.board[start] != BOARD_CELL_EMPTY || s.mark[start] == s.stamp) continue;
+
+			int area = 0;
+			s.stack.clear();
+			s.stack.push_back(start);
+			s.mark[start] = s.stamp;
+			while (!s.stack.empty()){
+				const int c = s.stack.back();
+				s.stack.pop_back();
+				area++;
+				for (int d2 = 0; d2 < 4; d2++){
+					const int n = c + dir[d2];
+					if (n < 0 || n >= size) continue;
+					if (s.board[n] != BOARD_CELL_EMPTY || s.mark[n] == s.stamp) continue;
+					s.mark[n] = s.stamp;
+					s.stack.push_back(n);
+				}
+			}
+			total += area;
+			rest += area % PIECE_BLOCK_NUM;
+		}
+	}
+	return required - (total + PIECE_BLOCK_NUM) % PIECE_BLOCK_NUM + rest;
+}
+
+/*!
+最初の空きセルをピースで覆う、または穴にする探索 (find_solution_table と同じ探索順で、穴にする手を最後に試す)
+
+@param s			探索の状態
+@param cell			最初の空きセル
+@param remain		配置するピースの数
+@param holes		残りの穴の数
+@param required		空き領域に必要な穴の数 (穴が残っている場合, -1:穴にした直後で未計算)
+*/
+static void find_sweep_solution(SweepSearch& s, const int cell, const int remain, const int holes, const int required){
+	s.call_num++;
+
+	int* board_base = &s.board[0];
+	//置換表 (穴が残っていないノード)
+	SweepMemo* entry = NULL;
+	unsigned long long frontier = 0;
+	unsigned int key = 0;
+	long long found = 0;
+	if (holes == 0 && remain >= SWEEP_MEMO_REMAIN_MIN && !s.memo.empty()){
+		const int* f = board_base + cell + 1;
+		const int len = min(s.frontier_len, (int)s.board.size() - cell - 1);
+		for (int k = 0; k < len; k++){
+			if (f[k] != BOARD_CELL_EMPTY) frontier |= 1ULL << k;
+		}
+		key = 1u | (unsigned)cell << 1 | s.used_bits << 9;
+		unsigned long long h = (frontier ^ ((unsigned long long)key << 32) ^ key) * 0x9E3779B97F4A7C15ULL;
+		entry = &s.memo[h >> (64 - SWEEP_MEMO_BITS)];
+		if (entry->key == key && entry->frontier == frontier){		//同じ部分木を探索済み
+			s.memo_hit++;
+			if (entry->num) record_sweep_solution(s, (int)s.board.size(), entry->num);
+			return;
+		}
+		found = s.found;
+	}
+	int* current_board = board_base + cell;
+	const int stride_num = s.stride_num;
+	const Placement* p = s.table.placement.data() + s.table.start[cell];
+	const Placement* end = s.table.placement.data() + s.table.start[cell + 1];
+
+	for (; p != end; ++p){
+		const int i = p->piece;
+		if (s.used[i]) { p += p->skip - 1; continue; }		//使用済みのピースの配置を飛ばす
+
+		const int* offset = p->offsets;
+		{
+			bool can_place = true;
+			for (int k = 1; k<PIECE_BLOCK_NUM; k++){		//k=0は自明
+				if (current_board[offset[k]] != BOARD_CELL_EMPTY) { can_place = false;  break; }
+			}
+			if (!can_place)	continue;
+		}
+
+		for (int k = 0; k<PIECE_BLOCK_NUM; k++){ current_board[offset[k]] = i; }
+		s.used[i] = true;
+		s.used_bits ^= 1u << i;
+
+		if (remain == 1){
+			record_sweep_solution(s, cell);
+		}
+		else {
+			int next = cell;
+			while (board_base[next] != BOARD_CELL_EMPTY){ next++; }
+			if (holes > 0){
+				const int next_required = (required < 0) ? count_required_holes(s, next) : update_required_holes(s, required, cell, offset);
+				if (next_required <= holes) find_sweep_solution(s, next, remain - 1, holes, next_required);
+			}
+			else if (board_base[next + 1] == BOARD_CELL_EMPTY || board_base[next + stride_num] == BOARD_CELL_EMPTY){
+				find_sweep_solution(s, next, remain - 1, holes, 0);
+			}
+		}
+
+		for (int k = 0; k<PIECE_BLOCK_NUM; k++){ current_board[offset[k]] = BOARD_CELL_EMPTY; }
+		s.used[i] = false;
+		s.used_bits ^= 1u << i;
+	}
+
+	if (entry){		//上書きする
+		entry->key = key;
+		entry->frontier = frontier;
+		entry->num = s.found - found;
+	}
+
+	if (holes > 0){		//穴にする
+		*current_board = BOARD_CELL_BOARDER;
+		s.hole.push_back(cell);
+
+		int next = cell;
+		while (board_base[next] != BOARD_CELL_EMPTY){ next++; }
+		find_sweep_solution(s, next, remain, holes - 1, -1);
+
+		s.hole.pop_back();
+		*current_board = BOARD_CELL_EMPTY;
+	}
+}
+
+/*!
+ジョブの探索ノード数の推定 (根から葉へのランダムな降下、Knuthの推定法)
+
+find_sweep_solution と同じ手(ピースの配置、穴)から一様に選んで降下する。
+*/
+static double estimate_sweep_job(SweepSearch& s, const int probe_num, const unsigned int seed){
+	mt19937 rng(seed);
+	int* board_base = &s.board[0];
+	double total = 0;
+
+	for (int probe = 0; probe < probe_num; probe++){
+		vector<pair<const Placement*, int>> placed;		//(配置 or NULL:穴, セル)
+		int cell = 0;
+		int remain = (int)s.used.size();
+		int holes = s.job.holes;
+		double weight = 1;
+		double nodes = 0;
+
+		for (;;){
+			nodes += weight;
+			if (remain == 0) break;
+			while (board_base[cell] != BOARD_CELL_EMPTY){ cell++; }
+			if (count_required_holes(s, cell) > holes) break;
+
+			vector<const Placement*> moves;
+			for (int n = s.table.start[cell]; n < s.table.start[cell + 1]; n++){
+				const Placement* p = &s.table.placement[n];
+				if (s.used[p->piece]) continue;
+				bool can_place = true;
+				for (int k = 1; k < PIECE_BLOCK_NUM; k++){
+					if (board_base[cell + p->offsets[k]] != BOARD_CELL_EMPTY) { can_place = false; break; }
+				}
+				if (can_place) moves.push_back(p);
+			}
+			if (holes > 0) moves.push_back(NULL);
+			if (moves.empty()) break;
+
+			weight *= (double)moves.size();
+			const Placement* p = moves[uniform_int_distribution<int>(0, (int)moves.size() - 1)(rng)];
+			if (p){
+				for (int k = 0; k < PIECE_BLOCK_NUM; k++){ board_base[cell + p->offsets[k]] = p->piece; }
+				s.used[p->piece] = true;
+				remain--;
+			}
+			else {
+				board_base[cell] = BOARD_CELL_BOARDER;
+				holes--;
+			}
+			placed.push_back(make_pair(p, cell));
+		}
+
+		for (auto& m : placed){
+			if (m.first){
+				for (int k = 0; k < PIECE_BLOCK_NUM; k++){ board_base[m.second + m.first->offsets[k]] = BOARD_CELL_EMPTY; }
+				s.used[m.first->piece] = false;
+			}
+			else board_base[m.second] = BOARD_CELL_EMPTY;
+		}
+		total += nodes;
+	}
+	return total / probe_num;
+}
+
+/*!
+解のある穴の位置の組の数 (ボードの回転・鏡像で重なる組は一つとして数える)
+
+冗長な形状の削除で、記録した組は対称変換で重なる組の一部だけなので、対称変換で最小の組に揃えて数える。
+*/
+static int count_mask_class(const SweepBoard& b, const int cols){
+	const int rows = b.rows;
+	const int stride_num = cols + 1;
+	const int sym_num = (rows == cols) ? 8 : 4;
+	set<vector<int>> mask_class;
+	for (const auto& mask : b.masks){
+		vector<int> canonical;
+		for (int t = 0; t < sym_num; t++){
+			vector<int> m;
+			for (int c : mask){
+				int y = c / stride_num;
+				int x = c % stride_num;
+				if (t & 1) y = rows - 1 - y;
+				if (t & 2) x = cols - 1 - x;
+				if (t & 4) swap(x, y);
+				m.push_back(y * stride_num + x);
+			}
+			sort(m.begin(), m.end());
+			if (t == 0 || m < canonical) canonical = m;
+		}
+		mask_class.insert(canonical);
+	}
+	return (int)mask_class.size();
+}
+
+/*!
+ジョブのボードと配置表の生成
+*/
+static void setup_sweep_job(const SweepJob& job, vector<Piece>& pieces, vector<int>& board, PlacementTable& table){
+	init_pieces(pieces, job.rows, job.cols);
+	board = create_board(job.rows, job.cols);
+	build_placement_table(table, pieces, board);
+}
+
+/*!
+worker thread (推定値の大きい順に並べたジョブを順に取り出す)
+*/
+static void sweep_worker(const int id, vector<SweepJob>& jobs, atomic<int>& next_job){
+	PerfCounter counter;
+	long long call_num = 0;
+	counter.Start();
+	for (;;){
+		const int j = next_job.fetch_add(1);
+		if (j >= (int)jobs.size()) break;
+		SweepJob& job = jobs[j];
+		if (!job.feasible) continue;
+
+		const auto start = chrono::steady_clock::now();
+		vector<Piece> pieces;
+		vector<int> board;
+		PlacementTable table;
+		setup_sweep_job(job, pieces, board, table);
+
+		SweepSearch s(job, table, board, (int)pieces.size());
+		if (s.frontier_len <= 64 && board.size() <= 256) s.memo.assign((size_t)1 << SWEEP_MEMO_BITS, SweepMemo{ 0, 0, 0 });
+		find_sweep_solution(s, 0, (int)pieces.size(), job.holes, count_required_holes(s, 0));
+		job.call_num = s.call_num;
+		job.memo_hit = s.memo_hit;
+		job.sec = chrono::duration_cast<chrono::duration<double>>(chrono::steady_clock::now() - start).count();
+		call_num += s.call_num;
+	}
+	counter.Stop();
+	profile_add_thread(id, counter, call_num);
+}
+
+//-----------------------------------------------------------------------------
+// public functions
+
+/*!
+ボードの族の一括探索
+
+@param areas 面積の一覧 "A[,A...]" (RxC:R行C列の長方形のみ)
+@param thread_num スレッド数 (0:コア数)
+@param compare 比較の為、ボードを一つずつ探索した場合の時間も計測するか?
+
+@return 解の数の合計 (回転・鏡像による解を除く, -1:書式エラー)
+*/
+int sweep_pentomino(const char* areas, int thread_num, const bool compare){
+	if (thread_num <= 0) thread_num = (int)thread::hardware_concurrency();
+	if (thread_num <= 0) thread_num = 1;
+
+	vector<Piece> pieces;
+	{
+		PhaseTimer phase(PROFILE_INIT_PIECES);
+		init_pieces(pieces, 1, 1);
+	}
+	const int piece_area = (int)pieces.size() * PIECE_BLOCK_NUM;
+
+	//族のボードを列数毎のジョブにまとめる
+	vector<SweepJob> jobs;
+	{
+		string f(areas);
+		size_t pos = 0;
+		while (pos < f.size()) {
+			size_t end = f.find(',', pos);
+			if (end == string::npos) end = f.size();
+			const string item = f.substr(pos, end - pos);
+			pos = end + 1;
+
+			//"A" 面積Aの全ての長方形, "RxC" R行C列の長方形
+			char* item_end;
+			long area = strtol(item.c_str(), &item_end, 10);
+			long only_cols = 0;
+			if (*item_end == 'x') {
+				const long r = area;
+				only_cols = strtol(item_end + 1, &item_end, 10);
+				if (r < 1 || only_cols < 1) return -1;
+				area = r * only_cols;
+				only_cols = min(r, only_cols);		//行数 >= 列数 の向き
+			}
+			if (item.empty() || *item_end || area < piece_area || area - piece_area > SWEEP_HOLE_MAX) return -1;
+
+			for (int cols = 1; cols * cols <= area; cols++){
+				if (area % cols) continue;
+				if (only_cols && cols != only_cols) continue;
+				SweepBoard b;
+				b.area = (int)area;
+				b.rows = (int)area / cols;
+				b.holes = (int)area - piece_area;
+				b.num = 0;
+
+				auto job = find_if(jobs.begin(), jobs.end(), [&](const SweepJob& j){ return j.cols == cols; });
+				if (job == jobs.end()){
+					SweepJob j;
+					j.cols = cols;
+					j.rows = 0;
+					j.holes = 0;
+					j.feasible = false;
+					j.estimate = 0;
+					j.call_num = 0;
+					j.memo_hit = 0;
+					j.sec = 0;
+					jobs.push_back(j);
+					job = jobs.end() - 1;
+				}
+				if (find_if(job->boards.begin(), job->boards.end(), [&](const SweepBoard& x){ return x.rows == b.rows; }) == job->boards.end()){
+					job->boards.push_back(b);
+				}
+				job->rows = max(job->rows, b.rows);
+			}
+		}
+	}
+
+	//ジョブの探索ノード数の推定 (全てのピースが置けない列数のジョブは探索しない)
+	//比較の為、族のボードを一つずつ探索した場合の探索ノード数も推定する (ランダムな試行による推定値で、探索はしない)
+	double independent_estimate = 0;
+	for (auto& job : jobs){
+		PhaseTimer phase(PROFILE_BOARD_SETUP);
+		job.holes = job.rows * job.cols - piece_area;
+		if (job.holes > SWEEP_HOLE_MAX) return -1;
+
+		vector<Piece> job_pieces;
+		vector<int> board;
+		PlacementTable table;
+		setup_sweep_job(job, job_pieces, board, table);
+
+		vector<bool> placeable(job_pieces.size(), false);
+		for (const auto& p : table.placement) placeable[p.piece] = true;
+		if (find(placeable.begin(), placeable.end(), false) != placeable.end()) continue;
+		job.feasible = true;
+
+		SweepSearch s(job, table, board, (int)job_pieces.size());
+		job.estimate = estimate_sweep_job(s, SWEEP_PROBES, 1);
+
+		for (const auto& b : job.boards){
+			if (b.rows == job.rows) { independent_estimate += job.estimate; continue; }
+			SweepJob single = job;
+			single.rows = b.rows;
+			single.holes = b.holes;
+			single.boards.assign(1, b);
+			vector<Piece> single_pieces;
+			vector<int> single_board;
+			PlacementTable single_table;
+			setup_sweep_job(single, single_pieces, single_board, single_table);
+			SweepSearch t(single, single_table, single_board, (int)single_pieces.size());
+			independent_estimate += estimate_sweep_job(t, SWEEP_PROBES, 1);
+		}
+	}
+	stable_sort(jobs.begin(), jobs.end(), [](const SweepJob& a, const SweepJob& b){ return a.estimate > b.estimate; });
+
+	int board_num = 0;
+	for (const auto& job : jobs) board_num += (int)job.boards.size();
+	printf("sweep boards:%d\tjobs:%d\tthread_num:%d\n", board_num, (int)jobs.size(), thread_num);
+	for (const auto& job : jobs){
+		printf("job cols:%d\trows:%d\tholes:%d\tboards:%d\testimate:%.3g\n", job.cols, job.rows, job.holes, (int)job.boards.size(), job.estimate);
+	}
+	fflush(stdout);
+
+	//推定値の大きい順にジョブを実行する
+	{
+		Timer tmr("process time:\t");
+		PhaseTimer phase(PROFILE_SEARCH);
+		atomic<int> next_job(0);
+		vector<thread> threads;
+		for (int id = 0; id < thread_num; id++){
+			threads.push_back(thread(sweep_worker, id, ref(jobs), ref(next_job)));
+		}
+		for (auto& th : threads) th.join();
+	}
+
+	//結果の表示 (面積、行数の順)
+	PhaseTimer phase(PROFILE_OUTPUT);
+	double job_sec = 0;
+	double job_estimate = 0;
+	long long call_num = 0;
+	for (const auto& job : jobs){
+		printf("job cols:%d\trows:%d\tholes:%d\tnodes:%lld\tmemo_hit:%lld\ttime:%.3f[s]\n", job.cols, job.rows, job.holes, job.call_num, job.memo_hit, job.sec);
+		job_sec += job.sec;
+		job_estimate += job.estimate;
+		call_num += job.call_num;
+	}
+	g_find_solution_call_num += call_num;
+	printf("sum of job time:\t%.3f[s]\tnodes:%lld\n", job_sec, call_num);
+	printf("estimated nodes (random probes, not searched):\tjobs:%.3g\tindependent boards:%.3g\n", job_estimate, independent_estimate);
+
+	//比較: 族のボードを一つずつ、同じ探索(置換表を含む)で数える
+	if (compare){
+		vector<SweepJob> singles;
+		for (const auto& job : jobs){
+			if (!job.feasible) continue;
+			for (const auto& b : job.boards){
+				SweepJob single = job;
+				single.rows = b.rows;
+				single.holes = b.holes;
+				single.boards.assign(1, b);
+				single.boards[0].num = 0;
+				single.boards[0].masks.clear();
+				single.call_num = 0;
+				single.memo_hit = 0;
+				single.sec = 0;
+				singles.push_back(single);
+			}
+		}
+		stable_sort(singles.begin(), singles.end(), [](const SweepJob& a, const SweepJob& b){ return a.rows * a.cols > b.rows * b.cols; });
+
+		const auto start = chrono::steady_clock::now();
+		atomic<int> next_job(0);
+		vector<thread> threads;
+		for (int id = 0; id < thread_num; id++){
+			threads.push_back(thread(sweep_worker, id, ref(singles), ref(next_job)));
+		}
+		for (auto& th : threads) th.join();
+		const double sec = chrono::duration_cast<chrono::duration<double>>(chrono::steady_clock::now() - start).count();
+
+		double single_sec = 0;
+		long long single_call_num = 0;
+		bool same = true;
+		for (const auto& single : singles){
+			single_sec += single.sec;
+			single_call_num += single.call_num;
+			const SweepBoard& b = single.boards[0];
+			for (const auto& job : jobs){
+				if (job.cols != single.cols) continue;
+				for (const auto& x : job.boards) if (x.rows == b.rows && x.num != b.num) same = false;
+			}
+		}
+		printf("independent boards:\tboards:%d\tnodes:%lld\tsum of time:%.3f[s]\ttime:%.3f[s]\tsolution_num:%s\n",
+			(int)singles.size(), single_call_num, single_sec, sec, same ? "same" : "DIFFERENT");
+	}
+
+	vector<pair<const SweepJob*, const SweepBoard*>> result;
+	for (const auto& job : jobs){
+		for (const auto& b : job.boards) result.push_back(make_pair(&job, &b));
+	}
+	sort(result.begin(), result.end(), [](const pair<const SweepJob*, const SweepBoard*>& a, const pair<const SweepJob*, const SweepBoard*>& b){
+		return (a.second->area != b.second->area) ? a.second->area < b.second->area : a.second->rows > b.second->rows;
+	});
+
+	long long total = 0;
+	for (const auto& r : result){
+		//正方形のボードは対称変換が8通りなので、冗長な形状の削除後も解を2回ずつ数えている
+		const SweepBoard& b = *r.second;
+		const long long num = (b.rows == r.first->cols) ? b.num / 2 : b.num;
+		printf("board rows:%d\tcols:%d\tholes:%d\tmask_num:%d\tsolution_num:%lld\n", b.rows, r.first->cols, b.holes, count_mask_class(b, r.first->cols), num);
+		total += num;
+	}
+	return (int)min(total, (long long)INT_MAX);
+}